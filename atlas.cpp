@@ -0,0 +1,102 @@
+#include <algorithm>
+#include "atlas.h"
+
+void TextureAtlas::add(const std::string &name, const sf::Image &image)
+{
+    images[name] = image;
+}
+
+bool TextureAtlas::build()
+{
+    //Shelf packing: place the images from the tallest to the shortest, left to right. When a row is full,
+    //start a new row below the tallest image of the current one.
+    std::vector<const std::string*> order;
+    for (auto &entry : images)
+        order.push_back(&entry.first);
+    std::stable_sort(order.begin(), order.end(), [this](const std::string *a, const std::string *b)
+    {
+        return images[*a].getSize().y > images[*b].getSize().y;
+    });
+
+    rects.clear();
+    int x = 0, y = 0, rowHeight = 0, atlasWidth = 1;
+    for (const std::string *name : order)
+    {
+        sf::Vector2u size = images[*name].getSize();
+        if(x > 0 && x + (int)size.x > MAX_WIDTH)
+        {
+            x = 0;
+            y += rowHeight + PADDING;
+            rowHeight = 0;
+        }
+        rects[*name] = sf::IntRect(x, y, size.x, size.y);
+        x += size.x + PADDING;
+        rowHeight = std::max(rowHeight, (int)size.y);
+        atlasWidth = std::max(atlasWidth, x);
+    }
+
+    sf::Image packed;
+    packed.create(atlasWidth, std::max(1, y + rowHeight), sf::Color::Transparent);
+    for (auto &entry : rects)
+        packed.copy(images[entry.first], entry.second.left, entry.second.top);
+    return texture.loadFromImage(packed);
+}
+
+const sf::Texture& TextureAtlas::getTexture() const
+{
+    return texture;
+}
+
+sf::IntRect TextureAtlas::getRect(const std::string &name) const
+{
+    auto it = rects.find(name);
+    if(it == rects.end())
+        return sf::IntRect(0,0,0,0);
+    return it->second;
+}
+
+SpriteBatch::SpriteBatch()
+{
+    vertices.setPrimitiveType(sf::Quads);
+}
+
+void SpriteBatch::clear()
+{
+    vertices.clear();
+}
+
+void SpriteBatch::add(const sf::IntRect &rect, float x, float y, bool rotate)
+{
+    float w = rect.width;
+    float h = rect.height;
+    float u = rect.left;
+    float v = rect.top;
+    //Corners of the image in the order top-left, top-right, bottom-right, bottom-left.
+    //A rotation by 90 degrees maps the local point (px,py) to (-py,px).
+    if(rotate)
+    {
+        vertices.append(sf::Vertex(sf::Vector2f(x, y), sf::Vector2f(u, v)));
+        vertices.append(sf::Vertex(sf::Vector2f(x, y + w), sf::Vector2f(u + w, v)));
+        vertices.append(sf::Vertex(sf::Vector2f(x - h, y + w), sf::Vector2f(u + w, v + h)));
+        vertices.append(sf::Vertex(sf::Vector2f(x - h, y), sf::Vector2f(u, v + h)));
+    }
+    else
+    {
+        vertices.append(sf::Vertex(sf::Vector2f(x, y), sf::Vector2f(u, v)));
+        vertices.append(sf::Vertex(sf::Vector2f(x + w, y), sf::Vector2f(u + w, v)));
+        vertices.append(sf::Vertex(sf::Vector2f(x + w, y + h), sf::Vector2f(u + w, v + h)));
+        vertices.append(sf::Vertex(sf::Vector2f(x, y + h), sf::Vector2f(u, v + h)));
+    }
+}
+
+void SpriteBatch::draw(sf::RenderTarget &target, const sf::Texture &texture)
+{
+    if(vertices.getVertexCount() == 0)
+        return;
+    target.draw(vertices, sf::RenderStates(&texture));
+}
+
+int SpriteBatch::getSize()
+{
+    return vertices.getVertexCount() / 4;
+}
@@ -0,0 +1,62 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+//All the images of the game packed into one texture. Drawing from a single texture lets the renderer put
+//every sprite of a frame into one vertex array, instead of binding a texture and issuing a draw call
+//per sprite.
+class TextureAtlas
+{
+    std::map<std::string, sf::Image> images; //Added images, keyed by name
+    std::map<std::string, sf::IntRect> rects; //Location of each image in the texture
+    sf::Texture texture; //The packed images
+public:
+    static const int MAX_WIDTH = 1024; //Width of the texture; it grows downwards as needed
+    static const int PADDING = 1; //Empty pixels between the images, so that sampling never bleeds over
+
+    //Adds an image to the atlas. The image is packed when build() is called.
+    void add(const std::string &name, const sf::Image &image);
+
+    //Packs the added images into the texture. Returns false if the texture could not be created.
+    bool build();
+
+    //Returns the packed texture
+    const sf::Texture& getTexture() const;
+
+    //Returns the location of the image in the texture, an empty rectangle if there is no such image.
+    sf::IntRect getRect(const std::string &name) const;
+};
+
+//Collects textured quads from one atlas and draws them with a single call.
+class SpriteBatch
+{
+    sf::VertexArray vertices; //Four vertices per sprite
+public:
+    SpriteBatch();
+
+    //Removes all the sprites
+    void clear();
+
+    /*
+    @brief
+        Adds a sprite to the batch.
+    @params
+        rect: location of the image in the atlas
+        x: horizontal position of the sprite
+        y: vertical position of the sprite
+        rotate: rotate the sprite by 90 degrees clockwise around (x,y), like sf::Sprite::setRotation(90)
+    */
+    void add(const sf::IntRect &rect, float x, float y, bool rotate = false);
+
+    //Draws all the sprites of the batch
+    void draw(sf::RenderTarget &target, const sf::Texture &texture);
+
+    //Returns the number of sprites in the batch
+    int getSize();
+};
+
+#endif
@@ -0,0 +1,726 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include "simulation.h"
+#include "workers.h"
+#include "kernels.h"
+#include "framestats.h"
+#include "protocol.h"
+#include "interest.h"
+
+//Benchmarks for the hot paths of the simulation. The results are printed as JSON, so two runs can be
+//compared before and after a change. `make bench` writes them to bench.json.
+//Every benchmark uses a fixed seed, so two runs measure exactly the same work.
+
+//Accumulates the time of the measured parts of a benchmark, so setup work can be left out.
+class Timer
+{
+    std::chrono::steady_clock::time_point begin;
+    double seconds = 0;
+public:
+    void start()
+    {
+        begin = std::chrono::steady_clock::now();
+    }
+    void stop()
+    {
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    }
+    double getSeconds()
+    {
+        return seconds;
+    }
+};
+
+struct Result
+{
+    std::string name;
+    std::vector<std::pair<std::string,double>> params;
+    long ops; //Number of operations measured
+    double seconds; //Time of the measured operations
+};
+
+class Bench
+{
+    double minTime; //Each benchmark runs at least this long
+    std::string filter; //Only the benchmarks whose name contains this run
+    std::vector<Result> results;
+public:
+    Bench(double minTime, const std::string &filter)
+    {
+        this->minTime = minTime;
+        this->filter = filter;
+    }
+
+    bool enabled(const std::string &name)
+    {
+        return name.find(filter) != std::string::npos;
+    }
+
+    //Calls body until minTime of measured time has passed. body measures its work with the timer and
+    //returns the number of operations it did.
+    template<typename F>
+    void run(const std::string &name, const std::vector<std::pair<std::string,double>> &params, F body)
+    {
+        Result result;
+        result.name = name;
+        result.params = params;
+        result.ops = 0;
+        Timer timer;
+        auto start = std::chrono::steady_clock::now();
+        do
+        {
+            result.ops += body(timer);
+        }
+        while(timer.getSeconds() < minTime
+              //Give up on benchmarks whose setup dominates
+              && std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < 20*minTime);
+        result.seconds = timer.getSeconds();
+        results.push_back(result);
+
+        std::cerr << name;
+        for (auto &p : params)
+            std::cerr << " " << p.first << "=" << p.second;
+        std::cerr << ": " << result.seconds * 1e9 / std::max(result.ops, 1L) << " ns/op\n";
+    }
+
+    void writeJson(std::ostream &out)
+    {
+        out << "{\n  \"min_time\": " << minTime << ",\n  \"benchmarks\": [\n";
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const Result &r = results[i];
+            out << "    {\"name\": \"" << r.name << "\", \"params\": {";
+            for (size_t j = 0; j < r.params.size(); j++)
+                out << (j ? ", " : "") << "\"" << r.params[j].first << "\": " << r.params[j].second;
+            out << "}, \"ops\": " << r.ops << ", \"seconds\": " << r.seconds
+                << ", \"ns_per_op\": " << r.seconds * 1e9 / std::max(r.ops, 1L)
+                << ", \"ops_per_sec\": " << (r.seconds > 0 ? r.ops / r.seconds : 0) << "}"
+                << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+    }
+};
+
+//A generated battlefield with obstacles on random cells. The side is chosen so that the obstacles
+//take about a third of the cells.
+struct Map
+{
+    int width;
+    int height;
+    World world; //Sandbags first, then barrels
+    ObstacleMap *obstacles;
+    OccupancyGrid *occupancy;
+
+    Map(int numObstacles, std::mt19937 &gen)
+    {
+        double cells = std::max(64.0, numObstacles * 3.0);
+        int side = std::sqrt(cells * CELL_WIDTH * CELL_HEIGHT);
+        width = std::max(CELL_WIDTH * 8, side);
+        height = std::max(CELL_HEIGHT * 8, side);
+        obstacles = new ObstacleMap(width,height);
+        occupancy = new OccupancyGrid(width,height);
+        for (int i = 0; i < numObstacles; i++)
+        {
+            int e = world.create(i < numObstacles / 2 ? World::Sandbag : World::Barrel);
+            int cell = occupancy->sample(gen);
+            occupancy->occupy(cell);
+            world.spawn(e,occupancy->getPosition(cell));
+            obstacles->setTile(world.getPosition(e),(ObstacleMap::Tile)World::TYPES[world.getType(e)].tile);
+        }
+    }
+
+    ~Map()
+    {
+        delete obstacles;
+        delete occupancy;
+    }
+};
+
+//Soldier states that shoot up, right, left and down
+static const int SHOOTING_STATES[4] = {0, 2, 6, 3};
+
+//Fills the pool with bullets at random positions inside the battlefield, flying in random directions
+static void fillBullets(BulletPool &pool, int n, int width, int height, std::mt19937 &gen)
+{
+    std::uniform_real_distribution<float> random_x(0, width);
+    std::uniform_real_distribution<float> random_y(0, height);
+    std::uniform_int_distribution<int> random_dir(0, 3);
+    //Fired alternately by players 0 and 1
+    while(pool.getCount() < n && pool.add(Coord(random_x(gen),random_y(gen)),SHOOTING_STATES[random_dir(gen)],35,pool.getCount() % 2))
+        ;
+}
+
+static void benchBullets(Bench &bench)
+{
+    const int counts[] = {1, 10, 100, 1000, 10000};
+    if(bench.enabled("bullet_add"))
+    {
+        for (int n : counts)
+        {
+            BulletPool pool(n,1024,768);
+            bench.run("bullet_add",{{"bullets",n}},[&](Timer &timer) -> long
+            {
+                timer.start();
+                for (int i = 0; i < n; i++)
+                    pool.add(Coord(500,400),SHOOTING_STATES[i % 4],35);
+                timer.stop();
+                while(pool.getCount() > 0)
+                    pool.remove(pool.getCount() - 1);
+                return n;
+            });
+        }
+    }
+    if(bench.enabled("bullet_update"))
+    {
+        for (int n : counts)
+        {
+            //Big enough that no bullet leaves the battlefield during the benchmark
+            const int side = 10000000;
+            std::mt19937 gen(1);
+            BulletPool pool(n,side,side);
+            std::uniform_int_distribution<int> random_dir(0, 3);
+            bench.run("bullet_update",{{"bullets",n}},[&](Timer &timer) -> long
+            {
+                while(pool.getCount() < n)
+                    pool.add(Coord(side/2,side/2),SHOOTING_STATES[random_dir(gen)],35);
+                timer.start();
+                for (int i = 0; i < 100; i++)
+                    pool.update();
+                timer.stop();
+                return 100L * n;
+            });
+        }
+    }
+    if(bench.enabled("bullet_collision"))
+    {
+        const int bulletCounts[] = {1, 100, 1000, 10000};
+        const int obstacleCounts[] = {10, 1000, 10000};
+        for (int m : obstacleCounts)
+        {
+            for (int n : bulletCounts)
+            {
+                std::mt19937 gen(2);
+                Map map(m,gen);
+                HitboxTable hitboxes;
+                CollisionGrid grid(map.width,map.height,&hitboxes);
+                grid.setObstacles(map.world);
+                Player players[2];
+                players[0].init(map.occupancy->getPosition(map.occupancy->sample(gen)));
+                players[1].init(map.occupancy->getPosition(map.occupancy->sample(gen)));
+                players[1].setTeam(1);
+                BulletPool pool(n,map.width,map.height);
+                fillBullets(pool,n,map.width,map.height,gen);
+                std::vector<unsigned char> state;
+                pool.saveState(state);
+                std::vector<int> destroyed;
+                bench.run("bullet_collision",{{"bullets",n},{"obstacles",m}},[&](Timer &timer) -> long
+                {
+                    //Bring back the bullets and barrels destroyed by the last round
+                    size_t offset = 0;
+                    pool.loadState(state,offset);
+                    for (int e : destroyed)
+                        map.world.spawn(e,map.world.getPosition(e));
+                    destroyed.clear();
+                    players[0].setRespawnFlag(0);
+                    players[1].setRespawnFlag(0);
+                    timer.start();
+                    pool.checkCollision(&grid,players,map.world,2,destroyed);
+                    timer.stop();
+                    return n;
+                });
+            }
+        }
+    }
+}
+
+//The SIMD kernels on their own, once per version the CPU supports. The version is part of the name,
+//e.g. kernel_move_bullets_avx2.
+static void benchKernels(Bench &bench)
+{
+    Kernels::Level best = Kernels::getLevel();
+    const int n = 10000;
+    std::mt19937 gen(8);
+    std::uniform_real_distribution<float> random_pos(0, 10000);
+    std::uniform_int_distribution<int> random_dir(0, 3);
+    std::vector<float> x(n), y(n), prevX(n), prevY(n), speed(n, 35);
+    std::vector<unsigned char> dir(n), outside(n);
+    std::vector<float> left(n), top(n), right(n), bottom(n);
+    std::vector<int> found(n);
+    for (int i = 0; i < n; i++)
+    {
+        x[i] = random_pos(gen);
+        y[i] = random_pos(gen);
+        dir[i] = random_dir(gen);
+        left[i] = random_pos(gen);
+        top[i] = random_pos(gen);
+        right[i] = left[i] + 100;
+        bottom[i] = top[i] + 100;
+    }
+    for (int level = Kernels::Scalar; level <= Kernels::AVX2; level++)
+    {
+        if(!Kernels::setLevel((Kernels::Level)level))
+            continue;
+        std::string suffix = std::string("_") + Kernels::getName((Kernels::Level)level);
+        if(bench.enabled("kernel_move_bullets" + suffix))
+        {
+            bench.run("kernel_move_bullets" + suffix,{{"bullets",n}},[&](Timer &timer) -> long
+            {
+                timer.start();
+                for (int i = 0; i < 100; i++)
+                    Kernels::moveBullets(x.data(),y.data(),prevX.data(),prevY.data(),speed.data(),dir.data(),n,
+                                         1e7,1e7,outside.data());
+                timer.stop();
+                return 100L * n;
+            });
+        }
+        if(bench.enabled("kernel_find_intersections" + suffix))
+        {
+            bench.run("kernel_find_intersections" + suffix,{{"boxes",n}},[&](Timer &timer) -> long
+            {
+                timer.start();
+                for (int i = 0; i < 100; i++)
+                    Kernels::findIntersections(left.data(),top.data(),right.data(),bottom.data(),n,
+                                                       x[i],y[i],x[i] + 22,y[i] + 2,found.data());
+                timer.stop();
+                return 100L * n;
+            });
+        }
+    }
+    Kernels::setLevel(best);
+}
+
+static void benchPlayers(Bench &bench)
+{
+    const int obstacleCounts[] = {10, 1000, 10000};
+    for (int m : obstacleCounts)
+    {
+        std::mt19937 gen(3);
+        Map map(m,gen);
+        //Random walk, changing direction every few steps
+        std::vector<Player::WalkDirection> dirs(4096);
+        std::uniform_int_distribution<int> random_dir(Player::Left, Player::Down);
+        for (size_t i = 0; i < dirs.size(); i += 8)
+            std::fill(dirs.begin() + i, dirs.begin() + i + 8, (Player::WalkDirection)random_dir(gen));
+        Player player;
+        player.init(map.occupancy->getPosition(map.occupancy->sample(gen)));
+
+        if(bench.enabled("player_walk"))
+        {
+            bench.run("player_walk",{{"obstacles",m}},[&](Timer &timer) -> long
+            {
+                timer.start();
+                for (size_t i = 0; i < dirs.size(); i++)
+                    player.walk(10,dirs[i],map.obstacles,map.width,map.height);
+                timer.stop();
+                return dirs.size();
+            });
+        }
+        if(bench.enabled("player_check_collision"))
+        {
+            //Test from the positions the random walk visits
+            std::vector<Coord> positions(dirs.size());
+            for (size_t i = 0; i < dirs.size(); i++)
+            {
+                player.walk(10,dirs[i],map.obstacles,map.width,map.height);
+                positions[i] = player.getPosition();
+            }
+            bench.run("player_check_collision",{{"obstacles",m}},[&](Timer &timer) -> long
+            {
+                int blocked = 0;
+                timer.start();
+                for (size_t i = 0; i < dirs.size(); i++)
+                {
+                    player.setPosition(positions[i]);
+                    blocked += player.checkCollision(10,dirs[i],map.obstacles,map.width,map.height);
+                }
+                timer.stop();
+                if(blocked < 0) //Keep the result alive
+                    std::cerr << blocked;
+                return dirs.size();
+            });
+        }
+    }
+}
+
+static void benchRespawn(Bench &bench)
+{
+    if(!bench.enabled("player_respawn"))
+        return;
+    const int sides[] = {1024, 6000, 20000};
+    const double densities[] = {0, 0.5, 0.9, 1};
+    for (int side : sides)
+    {
+        for (double density : densities)
+        {
+            std::mt19937 gen(4);
+            OccupancyGrid occupancy(side,side);
+            //Leave one cell free at full density
+            int taken = std::min((int)(occupancy.getSize() * density), occupancy.getSize() - 1);
+            for (int i = 0; i < taken; i++)
+                occupancy.occupy(occupancy.sample(gen));
+            Player player;
+            bench.run("player_respawn",{{"side",side},{"density",density}},[&](Timer &timer) -> long
+            {
+                timer.start();
+                for (int i = 0; i < 1000; i++)
+                    player.respawn(occupancy.getPosition(occupancy.sample(gen)));
+                timer.stop();
+                return 1000;
+            });
+        }
+    }
+}
+
+//Cost of recording a frame time, and of reading the percentiles for the overlay
+static void benchFrameStats(Bench &bench)
+{
+    if(!bench.enabled("frame_stats"))
+        return;
+    std::mt19937 gen(5);
+    std::lognormal_distribution<double> frameTime(std::log(16667.0), 0.3);
+    std::vector<uint32_t> times(4096);
+    for (uint32_t &t : times)
+        t = frameTime(gen);
+    FrameStats stats;
+    bench.run("frame_stats_add",{},[&](Timer &timer) -> long
+    {
+        timer.start();
+        for (uint32_t t : times)
+            stats.add(t);
+        timer.stop();
+        return times.size();
+    });
+    volatile uint32_t sink = 0;
+    bench.run("frame_stats_percentiles",{},[&](Timer &timer) -> long
+    {
+        timer.start();
+        for (int i = 0; i < 100; i++)
+            sink = sink + stats.getPercentile(0.5) + stats.getPercentile(0.95) + stats.getPercentile(0.99) + stats.getMax();
+        timer.stop();
+        return 100;
+    });
+}
+
+//Generated maps for the end to end benchmarks: side, barrels, sandbags
+static const int MAPS[][3] = {{1024, 15, 15}, {6000, 1500, 1500}, {20000, 10000, 10000}};
+
+static void benchStartup(Bench &bench)
+{
+    if(!bench.enabled("init_warzone"))
+        return;
+    for (auto &map : MAPS)
+    {
+        unsigned int seed = 5;
+        bench.run("init_warzone",{{"side",map[0]},{"barrels",map[1]},{"sandbags",map[2]}},[&](Timer &timer) -> long
+        {
+            timer.start();
+            Simulation sim(10,map[0],map[0],map[1],map[2],2);
+            sim.setSeed(seed++);
+            sim.initWarzone();
+            timer.stop();
+            return 1;
+        });
+    }
+}
+
+static void benchTicks(Bench &bench)
+{
+    if(!bench.enabled("tick"))
+        return;
+    for (auto &map : MAPS)
+    {
+        std::mt19937 gen(6);
+        Simulation *sim = nullptr;
+        std::uniform_int_distribution<int> random_dir(Player::Left, Player::None);
+        std::uniform_int_distribution<int> percent(0, 99);
+        bench.run("tick",{{"side",map[0]},{"barrels",map[1]},{"sandbags",map[2]}},[&](Timer &timer) -> long
+        {
+            if(!sim || sim->getWinner() != -1)
+            {
+                delete sim;
+                sim = new Simulation(10,map[0],map[0],map[1],map[2],2);
+                sim->setSeed(gen());
+                sim->initWarzone();
+            }
+            //Random inputs like the headless runner, then 100 ticks
+            timer.start();
+            int ticks = 0;
+            for (; ticks < 100 && sim->getWinner() == -1; ticks++)
+            {
+                for (int i = 0; i < sim->getNumPlayers(); i++)
+                {
+                    if(percent(gen) < 20)
+                    {
+                        Player::WalkDirection dir = (Player::WalkDirection)random_dir(gen);
+                        sim->clearPressed(i,sim->getPlayers()[i].getPressed());
+                        if(dir != Player::None)
+                            sim->setPressed(i,dir);
+                    }
+                    if(percent(gen) < 33)
+                        sim->shoot(i);
+                }
+                sim->tick();
+            }
+            timer.stop();
+            return ticks;
+        });
+        delete sim;
+    }
+}
+
+//Large matches on one thread and on every core, to see how the phases of a tick scale
+static void benchParallelTicks(Bench &bench)
+{
+    if(!bench.enabled("tick_parallel"))
+        return;
+    const int side = 6000, obstacles = 1500;
+    const int PLAYERS[] = {100, 1000};
+    std::vector<int> threadCounts = {1};
+    int cores = std::thread::hardware_concurrency();
+    if(cores > 1)
+        threadCounts.push_back(cores);
+    for (int threads : threadCounts)
+    {
+        WorkerPool pool(threads);
+        for (int np : PLAYERS)
+        {
+            std::mt19937 gen(7);
+            Simulation *sim = nullptr;
+            std::uniform_int_distribution<int> random_dir(Player::Left, Player::None);
+            std::uniform_int_distribution<int> percent(0, 99);
+            bench.run("tick_parallel",{{"players",np},{"threads",threads}},[&](Timer &timer) -> long
+            {
+                if(!sim || sim->getWinner() != -1)
+                {
+                    delete sim;
+                    sim = new Simulation(10,side,side,obstacles,obstacles,np,8192);
+                    sim->setSeed(gen());
+                    sim->setWorkerPool(&pool);
+                    sim->initWarzone();
+                }
+                timer.start();
+                int ticks = 0;
+                for (; ticks < 10 && sim->getWinner() == -1; ticks++)
+                {
+                    for (int i = 0; i < sim->getNumPlayers(); i++)
+                    {
+                        if(percent(gen) < 20)
+                        {
+                            Player::WalkDirection dir = (Player::WalkDirection)random_dir(gen);
+                            sim->clearPressed(i,sim->getPlayers()[i].getPressed());
+                            if(dir != Player::None)
+                                sim->setPressed(i,dir);
+                        }
+                        if(percent(gen) < 33)
+                            sim->shoot(i);
+                    }
+                    sim->tick();
+                }
+                timer.stop();
+                return ticks;
+            });
+            delete sim;
+        }
+    }
+}
+
+//Saving and restoring the state of a duel, as a rollback does every tick, next to the full saveState and
+//loadState. rollback_resimulate restores a state and simulates the ticks of a 10 tick rollback.
+static void benchRollback(Bench &bench)
+{
+    if(!bench.enabled("rollback") && !bench.enabled("state_"))
+        return;
+    const int ROLLBACK_TICKS = 10;
+    for (int m = 0; m < 2; m++)
+    {
+        const int *map = MAPS[m];
+        std::vector<std::pair<std::string,double>> params = {{"side",map[0]},{"barrels",map[1]},{"sandbags",map[2]}};
+        //Play a while, so there are bullets in flight and destroyed barrels
+        Simulation sim(10,map[0],map[0],map[1],map[2],2);
+        sim.setSeed(8);
+        sim.initWarzone();
+        std::mt19937 gen(8);
+        std::uniform_int_distribution<int> random_dir(Player::Left, Player::None);
+        std::uniform_int_distribution<int> percent(0, 99);
+        auto play = [&](int ticks)
+        {
+            for (int t = 0; t < ticks; t++)
+            {
+                for (int i = 0; i < sim.getNumPlayers(); i++)
+                {
+                    if(percent(gen) < 20)
+                    {
+                        Player::WalkDirection dir = (Player::WalkDirection)random_dir(gen);
+                        sim.clearPressed(i,sim.getPlayers()[i].getPressed());
+                        if(dir != Player::None)
+                            sim.setPressed(i,dir);
+                    }
+                    sim.shoot(i);
+                }
+                sim.tick();
+            }
+        };
+        play(200);
+        std::vector<unsigned char> state, full;
+        sim.saveRollbackState(state);
+        sim.saveState(full);
+
+        bench.run("rollback_save",params,[&](Timer &timer) -> long
+        {
+            timer.start();
+            for (int i = 0; i < 100; i++)
+                sim.saveRollbackState(state);
+            timer.stop();
+            return 100;
+        });
+        bench.run("rollback_load",params,[&](Timer &timer) -> long
+        {
+            timer.start();
+            for (int i = 0; i < 100; i++)
+                sim.loadRollbackState(state);
+            timer.stop();
+            return 100;
+        });
+        bench.run("rollback_resimulate",params,[&](Timer &timer) -> long
+        {
+            sim.loadRollbackState(state);
+            timer.start();
+            sim.loadRollbackState(state);
+            play(ROLLBACK_TICKS);
+            timer.stop();
+            return 1;
+        });
+        bench.run("state_save",params,[&](Timer &timer) -> long
+        {
+            timer.start();
+            for (int i = 0; i < 100; i++)
+            {
+                full.clear();
+                sim.saveState(full);
+            }
+            timer.stop();
+            return 100;
+        });
+        bench.run("state_load",params,[&](Timer &timer) -> long
+        {
+            timer.start();
+            for (int i = 0; i < 100; i++)
+                sim.loadState(full);
+            timer.stop();
+            return 100;
+        });
+    }
+}
+
+//What the game server does per tick to replicate a large match: sorting the soldiers and bullets into the
+//interest grid, and building and encoding the state of every client, with a limited view and with the
+//whole battlefield in view. Counted per client.
+static void benchInterest(Bench &bench)
+{
+    if(!bench.enabled("interest"))
+        return;
+    const int *map = MAPS[1];
+    const int PLAYERS = 500;
+    const int VIEWS[2] = {600, 0};
+    Simulation sim(10,map[0],map[0],map[1],map[2],PLAYERS);
+    sim.setSeed(9);
+    sim.initWarzone();
+    std::mt19937 gen(9);
+    for (int t = 0; t < 100; t++)
+    {
+        for (int i = 0; i < PLAYERS; i++)
+        {
+            if(gen() % 3 == 0)
+                sim.shoot(i);
+        }
+        sim.tick();
+    }
+    InterestGrid grid(map[0],map[0]);
+    grid.setEntities(sim.getWorld());
+    std::vector<std::pair<std::string,double>> params = {{"side",map[0]},{"players",PLAYERS}};
+    bench.run("interest_grid",params,[&](Timer &timer) -> long
+    {
+        timer.start();
+        for (int i = 0; i < 100; i++)
+            grid.update(&sim);
+        timer.stop();
+        return 100;
+    });
+    for (int view : VIEWS)
+    {
+        std::vector<AreaOfInterest> areas(PLAYERS, AreaOfInterest(view));
+        std::vector<NetState> states(PLAYERS);
+        std::vector<unsigned char> buffer;
+        params = {{"side",map[0]},{"players",PLAYERS},{"view",view}};
+        bench.run("interest_client",params,[&](Timer &timer) -> long
+        {
+            timer.start();
+            for (int p = 0; p < PLAYERS; p++)
+            {
+                NetState state;
+                areas[p].update(grid,&sim,p);
+                for (int player : areas[p].getPlayers())
+                    state.addSoldier(&sim,player);
+                areas[p].forEachBullet(grid,[&](int bullet)
+                {
+                    state.addBullet(&sim,bullet);
+                });
+                buffer.clear();
+                state.encode(&states[p],buffer,Protocol::MAX_PACKET);
+                states[p] = std::move(state);
+            }
+            timer.stop();
+            return PLAYERS;
+        });
+    }
+}
+
+int main(int argc, char **argv)
+{
+    double minTime = 0.2;
+    std::string filter, out;
+    for (int i = 1; i < argc; i++)
+    {
+        if(i + 1 < argc && !strcmp(argv[i],"--min-time"))
+            minTime = atof(argv[++i]);
+        else if(i + 1 < argc && !strcmp(argv[i],"--filter"))
+            filter = argv[++i];
+        else if(i + 1 < argc && !strcmp(argv[i],"--out"))
+            out = argv[++i];
+        else
+        {
+            std::cout << "Usage: game_bench [--min-time SECONDS] [--filter NAME] [--out FILE]\n";
+            return 1;
+        }
+    }
+
+    Bench bench(minTime,filter);
+    benchBullets(bench);
+    benchKernels(bench);
+    benchPlayers(bench);
+    benchRespawn(bench);
+    benchFrameStats(bench);
+    benchStartup(bench);
+    benchTicks(bench);
+    benchParallelTicks(bench);
+    benchRollback(bench);
+    benchInterest(bench);
+
+    if(out.empty())
+        bench.writeJson(std::cout);
+    else
+    {
+        std::ofstream file(out);
+        bench.writeJson(file);
+    }
+    return 0;
+}
@@ -0,0 +1,149 @@
+#include <cmath>
+#include <algorithm>
+#include "bots.h"
+#include "profiler.h"
+
+//Where the bullets come out of the rifle, relative to the soldier position, across the direction they fly
+//in (see BulletPool::add()). Indexed by Player::WalkDirection.
+static const float MUZZLE_OFFSET[4] = {38, 60, 75, 30};
+//Roughly the middle of the body of a soldier, relative to its position
+static const float BODY_X = 47;
+static const float BODY_Y = 56;
+
+void HunterBot::decide(const WorldSnapshot &world, int player, std::minstd_rand &gen, BotIntent &intent)
+{
+    intent.walk = Player::None;
+    intent.shoot = false;
+
+    //Find the nearest enemy
+    Coord me = world.pos[player];
+    int target = -1;
+    float best = 0;
+    for (size_t i = 0; i < world.pos.size(); i++)
+    {
+        if(world.team[i] == world.team[player])
+            continue;
+        float dx = world.pos[i].x - me.x;
+        float dy = world.pos[i].y - me.y;
+        float d = dx*dx + dy*dy;
+        if(target == -1 || d < best)
+        {
+            target = i;
+            best = d;
+        }
+    }
+    if(target == -1)
+        return;
+
+    //Shoot along the axis the enemy is farther away on, and line up with it on the other one
+    float dx = world.pos[target].x - me.x;
+    float dy = world.pos[target].y - me.y;
+    bool vertical = std::abs(dy) >= std::abs(dx);
+    Player::WalkDirection fireDir;
+    float error; //Distance between the line of fire and the body of the enemy
+    if(vertical)
+    {
+        fireDir = dy < 0 ? Player::Up : Player::Down;
+        error = MUZZLE_OFFSET[fireDir] - (dx + BODY_X);
+    }
+    else
+    {
+        fireDir = dx < 0 ? Player::Left : Player::Right;
+        error = MUZZLE_OFFSET[fireDir] - (dy + BODY_Y);
+    }
+
+    Player::WalkDirection facing = world.facing[player];
+    if(std::abs(error) < ALIGN_DISTANCE)
+    {
+        //Lined up: turn towards the enemy and fire
+        intent.shoot = facing == fireDir;
+        intent.walk = facing == fireDir ? Player::None : fireDir;
+    }
+    else if(vertical)
+        intent.walk = error > 0 ? Player::Left : Player::Right;
+    else
+        intent.walk = error > 0 ? Player::Up : Player::Down;
+
+    //Go around obstacles, and now and then walk somewhere else so bots do not get stuck on each other or
+    //keep shooting at a barrel
+    std::uniform_int_distribution<int> percent(0, 99);
+    if((intent.walk != Player::None && world.obstacles->isBlocked(me,intent.walk)) || percent(gen) < 5)
+    {
+        std::uniform_int_distribution<int> random_dir(Player::Left, Player::Down);
+        intent.walk = (Player::WalkDirection)random_dir(gen);
+    }
+}
+
+Bots::Bots(WorkerPool *pool)
+{
+    this->pool = pool;
+}
+
+void Bots::setController(int player, BotController *controller)
+{
+    if((int)controllers.size() <= player)
+        controllers.resize(player + 1, nullptr);
+    controllers[player] = controller;
+}
+
+int Bots::getNumBots()
+{
+    return controllers.size() - std::count(controllers.begin(), controllers.end(), nullptr);
+}
+
+void Bots::update(Simulation *sim)
+{
+    PROFILE_SCOPE("bots");
+    int np = std::min(sim->getNumPlayers(), (int)controllers.size());
+    if(np == 0)
+        return;
+
+    Player *players = sim->getPlayers();
+    world.tick = sim->getTick();
+    world.width = sim->getWidth();
+    world.height = sim->getHeight();
+    world.obstacles = sim->getObstacles();
+    world.pos.resize(sim->getNumPlayers());
+    world.team.resize(sim->getNumPlayers());
+    world.facing.resize(sim->getNumPlayers());
+    world.pressed.resize(sim->getNumPlayers());
+    for (int i = 0; i < sim->getNumPlayers(); i++)
+    {
+        world.pos[i] = players[i].getPosition();
+        world.team[i] = players[i].getTeam();
+        world.facing[i] = players[i].getFacing();
+        world.pressed[i] = players[i].getPressed();
+    }
+
+    //Every bot gets a generator of its own, seeded from the match, the tick and the player, so the
+    //decisions do not depend on the thread they are computed on.
+    unsigned int seed = sim->getSeed();
+    intents.resize(np);
+    pool->parallelFor(np, 16, [&](int begin, int end)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            if(!controllers[i])
+                continue;
+            std::minstd_rand gen(seed ^ (world.tick * 2654435761u) ^ (i * 40503u + 1));
+            controllers[i]->decide(world,i,gen,intents[i]);
+        }
+    });
+
+    //Give the commands in the order of the players
+    for (int i = 0; i < np; i++)
+    {
+        if(!controllers[i])
+            continue;
+        Player::WalkDirection current = world.pressed[i];
+        if(intents[i].walk != current)
+        {
+            if(current != Player::None)
+                sim->clearPressed(i,current);
+            if(intents[i].walk != Player::None)
+                sim->setPressed(i,intents[i].walk);
+        }
+        if(intents[i].shoot)
+            sim->shoot(i);
+    }
+}
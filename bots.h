@@ -0,0 +1,75 @@
+#ifndef BOTS_H
+#define BOTS_H
+
+#include <vector>
+#include <random>
+#include "simulation.h"
+#include "workers.h"
+
+//Read-only copy of the world the bots decide on. It is taken between two ticks, so every bot sees the same
+//world no matter in which order, or on which thread, the bots run.
+struct WorldSnapshot
+{
+    int tick;
+    int width; //Battlefield width
+    int height; //Battlefield height
+    const ObstacleMap *obstacles; //Does not change between two ticks
+    std::vector<Coord> pos; //Positions of the soldiers
+    std::vector<int> team; //Teams of the soldiers
+    std::vector<Player::WalkDirection> facing; //Directions the rifles point in, see Player::getFacing()
+    std::vector<Player::WalkDirection> pressed; //Directions the soldiers walk in
+};
+
+//Commands of a soldier for one tick, the same ones a human gives with the keyboard
+struct BotIntent
+{
+    Player::WalkDirection walk; //None to stand still
+    bool shoot;
+};
+
+//Decides the commands of a soldier that is not played by a human
+class BotController
+{
+public:
+    //Decides what the given player does in the next tick. This is called in parallel for different players,
+    //so it must not change anything but the intent. gen belongs to this player and tick alone.
+    virtual void decide(const WorldSnapshot &world, int player, std::minstd_rand &gen, BotIntent &intent) = 0;
+
+    virtual ~BotController() {}
+};
+
+//Walks towards the nearest enemy, lines up with it and shoots when it is in the line of fire
+class HunterBot: public BotController
+{
+public:
+    static const int ALIGN_DISTANCE = 15; //Enemies closer than this to the line of fire are shot at
+
+    //Inherited function
+    void decide(const WorldSnapshot &world, int player, std::minstd_rand &gen, BotIntent &intent);
+};
+
+//Runs the bots of a match. The decisions are computed on a worker pool, then given to the simulation in
+//the order of the players, so a match with bots is as deterministic as one without.
+class Bots
+{
+    WorkerPool *pool; //Threads the decisions are computed on
+    std::vector<BotController*> controllers; //Controller of each player, null for humans
+    std::vector<BotIntent> intents; //Decisions of the current tick
+    WorldSnapshot world;
+public:
+    //pool must outlive the bots
+    Bots(WorkerPool *pool);
+
+    //Lets the controller play the given player. Pass null to take the player back. The controller must
+    //outlive the bots.
+    void setController(int player, BotController *controller);
+
+    //Returns the number of players controlled by bots
+    int getNumBots();
+
+    //Takes a snapshot of the simulation, computes the decisions of all the bots in parallel and gives their
+    //commands to the simulation. Call before every tick.
+    void update(Simulation *sim);
+};
+
+#endif
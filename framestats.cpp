@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <cmath>
+#include "framestats.h"
+
+FrameStats::FrameStats()
+{
+    clear();
+}
+
+void FrameStats::clear()
+{
+    for (int i = 0; i < NUM_BUCKETS; i++)
+        counts[i] = 0;
+    for (int i = 0; i < WINDOW; i++)
+        samples[i] = 0;
+    numAdded = 0;
+}
+
+int FrameStats::getCount() const
+{
+    return std::min<uint32_t>(numAdded.load(std::memory_order_acquire), WINDOW);
+}
+
+uint32_t FrameStats::getPercentile(double p) const
+{
+    int count = getCount();
+    if(count == 0)
+        return 0;
+    //The sample of this rank (1 is the shortest) is the percentile
+    uint32_t rank = std::max(1, std::min(count, (int)std::ceil(p * count)));
+    uint32_t seen = 0;
+    for (int i = 0; i < NUM_BUCKETS; i++)
+    {
+        seen += counts[i].load(std::memory_order_relaxed);
+        if(seen >= rank)
+        {
+            uint32_t start = getBucketStart(i);
+            uint32_t end = i + 1 < NUM_BUCKETS ? getBucketStart(i + 1) : UINT32_MAX;
+            return start + (end - start) / 2;
+        }
+    }
+    return getMax();
+}
+
+uint32_t FrameStats::getMax() const
+{
+    int count = getCount();
+    uint32_t max = 0;
+    for (int i = 0; i < count; i++)
+        max = std::max(max, samples[i].load(std::memory_order_relaxed));
+    return max;
+}
+
+uint32_t FrameStats::getBucketStart(int bucket)
+{
+    if(bucket < SUB_BUCKETS)
+        return bucket;
+    int octave = bucket / SUB_BUCKETS + SUB_BITS - 1;
+    return (uint32_t)(SUB_BUCKETS + bucket % SUB_BUCKETS) << (octave - SUB_BITS);
+}
@@ -0,0 +1,71 @@
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#include <atomic>
+#include <cstdint>
+
+//Histogram of the durations of the last WINDOW frames, for percentiles of e.g. the frame time.
+//Durations are sorted into log-linear buckets: every power of two is split into SUB_BUCKETS buckets of equal
+//width, so a percentile is off by at most 1/(2*SUB_BUCKETS) of its value. Adding a sample is a handful of
+//loads and stores without locks or allocation.
+//One thread adds the samples; any thread may read the statistics at the same time. A reader on another
+//thread may see a sample half added, which shifts the statistics by at most one sample.
+class FrameStats
+{
+public:
+    static const int WINDOW = 256; //Number of samples the statistics cover
+    static const int SUB_BITS = 4;
+    static const int SUB_BUCKETS = 1 << SUB_BITS; //Buckets per power of two
+    static const int NUM_BUCKETS = (32 - SUB_BITS + 1) * SUB_BUCKETS; //Enough for any 32 bit duration
+
+private:
+    std::atomic<uint32_t> counts[NUM_BUCKETS]; //Samples in the window, per bucket
+    std::atomic<uint32_t> samples[WINDOW]; //Durations of the last WINDOW samples, the oldest is overwritten
+    std::atomic<uint32_t> numAdded; //Number of samples ever added
+
+public:
+    FrameStats();
+
+    //Forgets all the samples
+    void clear();
+
+    //Adds a sample, in microseconds. The oldest sample leaves the window.
+    void add(uint32_t micros)
+    {
+        uint32_t n = numAdded.load(std::memory_order_relaxed);
+        int slot = n % WINDOW;
+        if(n >= WINDOW)
+        {
+            int old = getBucket(samples[slot].load(std::memory_order_relaxed));
+            counts[old].store(counts[old].load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+        }
+        int bucket = getBucket(micros);
+        counts[bucket].store(counts[bucket].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        samples[slot].store(micros, std::memory_order_relaxed);
+        numAdded.store(n + 1, std::memory_order_release);
+    }
+
+    //Returns the number of samples in the window
+    int getCount() const;
+
+    //Returns the duration that the fraction p (0 to 1) of the samples in the window do not exceed, in
+    //microseconds. The value is the middle of its bucket. Returns 0 if there are no samples.
+    uint32_t getPercentile(double p) const;
+
+    //Returns the longest duration in the window, in microseconds
+    uint32_t getMax() const;
+
+    //Returns the bucket of a duration
+    static int getBucket(uint32_t micros)
+    {
+        if(micros < SUB_BUCKETS)
+            return micros;
+        int octave = 31 - __builtin_clz(micros);
+        return (octave - SUB_BITS + 1) * SUB_BUCKETS + ((micros >> (octave - SUB_BITS)) & (SUB_BUCKETS - 1));
+    }
+
+    //Returns the shortest duration of a bucket
+    static uint32_t getBucketStart(int bucket);
+};
+
+#endif
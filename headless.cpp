@@ -0,0 +1,444 @@
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include "simulation.h"
+#include "replay.h"
+#include "bots.h"
+#include "kernels.h"
+#include "profiler.h"
+#include "netclient.h"
+#include "rollback.h"
+
+//Headless runner. Plays matches without a window as fast as the CPU allows, with random inputs.
+//Useful for soak tests and balance runs on machines without a display.
+
+//Command line options
+struct Options
+{
+    long ticks = 100000; //Total number of ticks to simulate
+    unsigned int seed = 1; //Seed for the random inputs and the object placement
+    float speed = 10;
+    int width = 1024;
+    int height = 768;
+    int barrels = 15;
+    int sandbags = 15;
+    int players = 2;
+    int teams = 0; //Number of teams, 0 means every player is a team of its own
+    bool bots = false; //Play with bots instead of random inputs
+    int threads = 0; //Threads for the bots and the simulation, 0 means one per core
+    int maxBullets = 1024; //Capacity of the bullet pool
+    int tickRate = Simulation::BASE_TICK_RATE; //Ticks per simulated second
+    const char *record = nullptr; //File to record the first match to
+    const char *replay = nullptr; //File to play back instead of playing random matches
+    int seek = 0; //Tick to start the playback at
+    const char *trace = nullptr; //File to write the profile to at the end, needs "make profile"
+    const char *connect = nullptr; //HOST or HOST:PORT of a game_server to play on instead
+    const char *peer = nullptr; //HOST:PORT of the other peer of a rollback duel to play instead
+    int listen = 0; //Port to listen on for the other peer
+    int player = 0; //Player of the duel we play, 0 or 1
+    int latency = 0; //Simulated one way latency of the link to the other peer, in ms
+    int jitter = 0; //Simulated jitter on top of the latency, in ms
+    int loss = 0; //Simulated packet loss, in percent
+};
+
+static void printUsage()
+{
+    std::cout << "Usage: game_headless [--ticks N] [--seed N] [--speed N] [--width N] [--height N]\n"
+                 "                     [--barrels N] [--sandbags N] [--players N] [--teams N] [--max-bullets N]\n"
+                 "                     [--tick-rate N] [--record FILE] [--bots 0|1] [--threads N] [--trace FILE]\n"
+                 "       game_headless --replay FILE [--seek TICK] [--threads N] [--trace FILE]\n"
+                 "       game_headless --connect HOST[:PORT] [--ticks N] [--seed N]\n"
+                 "       game_headless --peer HOST:PORT --listen PORT --player 0|1 [--latency MS] [--jitter MS]\n"
+                 "                     [--loss PERCENT] [--ticks N] [--seed N] [--tick-rate N]\n";
+}
+
+//Returns the settings of a match started with the options
+static ReplaySettings getSettings(const Options &opt)
+{
+    return {opt.speed, opt.width, opt.height, opt.barrels, opt.sandbags, opt.players, opt.teams, opt.maxBullets,
+            opt.tickRate, false, opt.seed};
+}
+
+//Parses the command line. Returns false if an option is unknown or misses its value.
+static bool parseOptions(int argc, char **argv, Options &opt)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if(i + 1 >= argc)
+            return false;
+        const char *name = argv[i];
+        const char *value = argv[++i];
+        if(!strcmp(name,"--ticks"))
+            opt.ticks = atol(value);
+        else if(!strcmp(name,"--seed"))
+            opt.seed = strtoul(value,nullptr,10);
+        else if(!strcmp(name,"--speed"))
+            opt.speed = atof(value);
+        else if(!strcmp(name,"--width"))
+            opt.width = atoi(value);
+        else if(!strcmp(name,"--height"))
+            opt.height = atoi(value);
+        else if(!strcmp(name,"--barrels"))
+            opt.barrels = atoi(value);
+        else if(!strcmp(name,"--sandbags"))
+            opt.sandbags = atoi(value);
+        else if(!strcmp(name,"--players"))
+            opt.players = atoi(value);
+        else if(!strcmp(name,"--teams"))
+            opt.teams = atoi(value);
+        else if(!strcmp(name,"--bots"))
+            opt.bots = atoi(value) != 0;
+        else if(!strcmp(name,"--threads"))
+            opt.threads = atoi(value);
+        else if(!strcmp(name,"--max-bullets"))
+            opt.maxBullets = atoi(value);
+        else if(!strcmp(name,"--tick-rate"))
+            opt.tickRate = std::max(1, atoi(value));
+        else if(!strcmp(name,"--record"))
+            opt.record = value;
+        else if(!strcmp(name,"--replay"))
+            opt.replay = value;
+        else if(!strcmp(name,"--seek"))
+            opt.seek = atoi(value);
+        else if(!strcmp(name,"--trace"))
+            opt.trace = value;
+        else if(!strcmp(name,"--connect"))
+            opt.connect = value;
+        else if(!strcmp(name,"--peer"))
+            opt.peer = value;
+        else if(!strcmp(name,"--listen"))
+            opt.listen = atoi(value);
+        else if(!strcmp(name,"--player"))
+            opt.player = atoi(value);
+        else if(!strcmp(name,"--latency"))
+            opt.latency = atoi(value);
+        else if(!strcmp(name,"--jitter"))
+            opt.jitter = atoi(value);
+        else if(!strcmp(name,"--loss"))
+            opt.loss = atoi(value);
+        else
+            return false;
+    }
+    return true;
+}
+
+//Feeds random commands to every player, roughly like a person mashing the keyboard.
+static void randomInputs(Simulation &sim, std::mt19937 &gen)
+{
+    std::uniform_int_distribution<int> random_dir(Player::Left, Player::None);
+    std::uniform_int_distribution<int> percent(0, 99);
+    for (int i = 0; i < sim.getNumPlayers(); i++)
+    {
+        //Change direction every ~5 ticks and shoot every ~3 ticks
+        if(percent(gen) < 20)
+        {
+            Player::WalkDirection dir = (Player::WalkDirection)random_dir(gen);
+            sim.clearPressed(i,sim.getPlayers()[i].getPressed());
+            if(dir != Player::None)
+                sim.setPressed(i,dir);
+        }
+        if(percent(gen) < 33)
+            sim.shoot(i);
+    }
+}
+
+//Writes the profile if it was asked for
+static void writeTrace(const Options &opt)
+{
+    if(!opt.trace)
+        return;
+    if(!Profiler::isEnabled())
+        std::cout << "The profiler is not built in, build with \"make profile\"\n";
+    else if(!Profiler::writeTrace(opt.trace))
+        std::cout << "Can not write trace " << opt.trace << "\n";
+    else
+        std::cout << "profile: " << opt.trace << "\n";
+}
+
+//Plays a recorded match back as fast as possible. The final state hash is the same as the one printed
+//when the match was recorded, unless the simulation changed in between.
+static int playReplay(const Options &opt)
+{
+    Replay replay;
+    if(!replay.load(opt.replay))
+    {
+        std::cout << "Can not read replay " << opt.replay << "\n";
+        return 1;
+    }
+    if(replay.getSettings().precise)
+        std::cout << "warning: the match used precise collisions, which need the images. Play it back with the game.\n";
+
+    WorkerPool pool(opt.threads);
+    auto start = std::chrono::steady_clock::now();
+    Simulation *sim = replay.createSimulation();
+    sim->setWorkerPool(&pool);
+    if(!replay.seek(sim,opt.seek))
+    {
+        std::cout << "The replay does not fit the simulation\n";
+        delete sim;
+        return 1;
+    }
+    auto seeked = std::chrono::steady_clock::now();
+    long ticks = 0;
+    while(!replay.isFinished(sim))
+    {
+        replay.applyInputs(sim);
+        sim->tick();
+        ticks++;
+    }
+    auto end = std::chrono::steady_clock::now();
+    double seekTime = std::chrono::duration<double>(seeked - start).count();
+    double elapsed = std::chrono::duration<double>(end - seeked).count();
+
+    std::cout << "replay length: " << replay.getLength() << " ticks\n"
+              << "seek to tick " << opt.seek << ": " << seekTime << " s\n"
+              << "ticks: " << ticks << "\n"
+              << "elapsed: " << elapsed << " s\n"
+              << "ticks/s: " << (elapsed > 0 ? ticks / elapsed : 0) << "\n"
+              << "winner: " << (sim->getWinner() == -1 ? "none" : (sim->getNumTeams() < sim->getNumPlayers() ? "team " : "player ")
+                                + std::to_string(sim->getWinner() + 1)) << "\n"
+              << "final state: " << std::hex << Replay::hashState(sim) << std::dec << "\n";
+    writeTrace(opt);
+    delete sim;
+    return 0;
+}
+
+//Plays one player of a match on a game_server with random commands, for load tests of the server. Prints
+//the traffic at the end.
+static int playOnline(const Options &opt)
+{
+    std::string host = opt.connect;
+    int port = Protocol::DEFAULT_PORT;
+    size_t colon = host.find(':');
+    if(colon != std::string::npos)
+    {
+        port = atoi(host.c_str() + colon + 1);
+        host.resize(colon);
+    }
+    NetClient client;
+    if(!client.connect(host,port,5000))
+    {
+        std::cout << "Can not join the server at " << host << ":" << port << "\n";
+        return 1;
+    }
+    const ReplaySettings &settings = client.getSettings();
+    std::cout << "playing player " << client.getPlayer() + 1 << " of " << settings.players << "\n";
+
+    std::mt19937 gen{opt.seed};
+    std::uniform_int_distribution<int> random_dir(Player::Left, Player::None);
+    std::uniform_int_distribution<int> percent(0, 99);
+    Player::WalkDirection held = Player::None;
+    long states = 0;
+    long seen = 0; //Soldiers in view, summed over the states
+    int silent = 0; //Time without a state, in ms
+    auto start = std::chrono::steady_clock::now();
+    while(states < opt.ticks && client.getWinner() == -1 && silent < 5000)
+    {
+        if(!client.receive(100))
+        {
+            silent += 100;
+            client.sendInput(); //Keep the server from dropping us
+            continue;
+        }
+        silent = 0;
+        states++;
+        seen += client.getState().players.size();
+        //Same habits as randomInputs()
+        if(percent(gen) < 20)
+        {
+            if(held != Player::None)
+                client.addCommand(InputListener::Release,held);
+            held = (Player::WalkDirection)random_dir(gen);
+            if(held != Player::None)
+                client.addCommand(InputListener::Press,held);
+        }
+        if(percent(gen) < 33)
+            client.addCommand(InputListener::Shoot,Player::None);
+        client.sendInput();
+    }
+    client.disconnect();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const NetState &state = client.getState();
+    int winner = client.getWinner();
+    std::cout << "states: " << states << " (" << client.getFullStates() << " full, " << client.getDeltaStates() << " deltas)\n"
+              << "last tick: " << state.tick << "\n"
+              << "soldiers in view: " << (double)seen / std::max(states, 1L) << " of " << settings.players << "\n"
+              << "winner: " << (winner == -1 ? "none" : std::to_string(winner + 1)) << "\n"
+              << "received: " << client.getBytesReceived() << " B, " << (int)(client.getBytesReceived() / std::max(elapsed, 1e-3))
+              << " B/s, " << client.getBytesReceived() / std::max(states, 1L) << " B/state\n"
+              << "sent: " << client.getBytesSent() << " B, " << (int)(client.getBytesSent() / std::max(elapsed, 1e-3)) << " B/s\n";
+    return silent >= 5000 ? 1 : 0;
+}
+
+//Plays a rollback duel against another peer in real time, with random commands for our player. Both peers
+//print the same final state if they simulated the same match.
+static int playPeer(const Options &opt)
+{
+    std::string host = opt.peer;
+    size_t colon = host.find(':');
+    if(colon == std::string::npos)
+    {
+        printUsage();
+        return 1;
+    }
+    int port = atoi(host.c_str() + colon + 1);
+    host.resize(colon);
+    //Player 0 decides the match; player 1 takes these settings from it
+    ReplaySettings settings = getSettings(opt);
+    settings.players = 2;
+    RollbackSession session;
+    session.setSimulatedLink(opt.latency,opt.jitter,opt.loss);
+    if(!session.connect(host,port,opt.listen,opt.player,settings,30000))
+    {
+        std::cout << "Can not play against the peer at " << host << ":" << port
+                  << ": no answer, the same player, or not a two player match without precise collisions\n";
+        return 1;
+    }
+    settings = session.getSettings();
+    Simulation sim(settings.speed,settings.width,settings.height,settings.barrels,settings.sandbags,settings.players,
+                   settings.maxBullets,settings.tickRate);
+    sim.setSeed(settings.seed);
+    if(settings.teams > 0)
+        sim.setTeams(settings.teams);
+    sim.initWarzone();
+    session.start(&sim);
+    std::cout << "playing player " << opt.player + 1 << " against " << host << ":" << port << "\n";
+
+    std::mt19937 gen{opt.seed + opt.player};
+    std::uniform_int_distribution<int> random_dir(Player::Left, Player::None);
+    std::uniform_int_distribution<int> percent(0, 99);
+    Player::WalkDirection held = Player::None;
+    //Ticks in real time; advance() holds back while the other peer is too far behind
+    const auto tickTime = std::chrono::microseconds(1000000 / settings.tickRate);
+    auto start = std::chrono::steady_clock::now();
+    auto next = start;
+    auto silentSince = start; //Time of the last tick simulated or confirmed
+    int confirmed = 0;
+    while(std::chrono::steady_clock::now() - silentSince < std::chrono::seconds(5))
+    {
+        bool over = sim.getWinner() != -1 || sim.getTick() >= opt.ticks;
+        if(over && session.isConfirmed() && session.isDelivered())
+            break;
+        auto now = std::chrono::steady_clock::now();
+        if(now >= next)
+        {
+            next += tickTime;
+            if(over)
+                session.sendInputs();
+            else
+            {
+                //Same habits as randomInputs(), but only for a tick that is simulated
+                if(percent(gen) < 20)
+                {
+                    if(held != Player::None)
+                        session.addCommand(InputListener::Release,held);
+                    held = (Player::WalkDirection)random_dir(gen);
+                    if(held != Player::None)
+                        session.addCommand(InputListener::Press,held);
+                }
+                if(percent(gen) < 33)
+                    session.addCommand(InputListener::Shoot,Player::None);
+                if(session.advance())
+                    silentSince = now;
+                else
+                    next = now + tickTime;
+            }
+        }
+        int wait = std::chrono::duration_cast<std::chrono::milliseconds>(next - std::chrono::steady_clock::now()).count();
+        session.receive(std::max(wait, 0));
+        if(session.isConfirmed() && sim.getTick() > confirmed)
+        {
+            confirmed = sim.getTick();
+            silentSince = std::chrono::steady_clock::now();
+        }
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int winner = sim.getWinner();
+    std::cout << "ticks: " << sim.getTick() << (session.isConfirmed() ? "" : " (not confirmed, the peer went silent)") << "\n"
+              << "winner: " << (winner == -1 ? "none" : std::to_string(winner + 1)) << "\n"
+              << "rollbacks: " << session.getRollbacks() << ", " << session.getResimulatedTicks() << " ticks simulated again, at most "
+              << session.getMaxDepth() << " at once, longest " << session.getMaxRollbackMicros() << " us\n"
+              << "stalls: " << session.getStalls() << "\n"
+              << "sent: " << session.getBytesSent() << " B, " << (int)(session.getBytesSent() / std::max(elapsed, 1e-3)) << " B/s\n"
+              << "final state: " << std::hex << Replay::hashState(&sim) << std::dec << "\n";
+    return session.isConfirmed() ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    if(!parseOptions(argc,argv,opt))
+    {
+        printUsage();
+        return 1;
+    }
+    if(opt.replay)
+        return playReplay(opt);
+    if(opt.connect)
+        return playOnline(opt);
+    if(opt.peer)
+        return playPeer(opt);
+    if(!getSettings(opt).isValid())
+    {
+        std::cout << "A match can not be played with these settings\n";
+        printUsage();
+        return 1;
+    }
+
+    std::mt19937 gen{opt.seed};
+    Replay replay;
+    WorkerPool pool(opt.threads);
+    HunterBot hunter;
+    long ticks = 0;
+    int matches = 0;
+    auto start = std::chrono::steady_clock::now();
+    while(ticks < opt.ticks)
+    {
+        Simulation sim(opt.speed,opt.width,opt.height,opt.barrels,opt.sandbags,opt.players,opt.maxBullets,opt.tickRate);
+        sim.setSeed(gen());
+        sim.setWorkerPool(&pool);
+        if(opt.teams > 0)
+            sim.setTeams(opt.teams);
+        sim.initWarzone();
+        bool recording = opt.record && ticks == 0;
+        if(recording)
+            replay.startRecording(&sim);
+        Bots bots(&pool);
+        for (int i = 0; opt.bots && i < sim.getNumPlayers(); i++)
+            bots.setController(i,&hunter);
+        while(ticks < opt.ticks && sim.getWinner() == -1)
+        {
+            if(opt.bots)
+                bots.update(&sim);
+            else
+                randomInputs(sim,gen);
+            sim.tick();
+            ticks++;
+        }
+        if(sim.getWinner() != -1)
+            matches++;
+        if(recording)
+        {
+            replay.stopRecording();
+            if(!replay.save(opt.record))
+                std::cout << "Can not write replay " << opt.record << "\n";
+            std::cout << "recorded: " << replay.getLength() << " ticks, final state: "
+                      << std::hex << Replay::hashState(&sim) << std::dec << "\n";
+        }
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "ticks: " << ticks << "\n"
+              << "kernels: " << Kernels::getName(Kernels::getLevel()) << "\n"
+              << "matches finished: " << matches << "\n"
+              << "elapsed: " << elapsed << " s\n"
+              << "ticks/s: " << (elapsed > 0 ? ticks / elapsed : 0) << "\n";
+    writeTrace(opt);
+    return 0;
+}
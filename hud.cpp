@@ -0,0 +1,111 @@
+#include <cstdio>
+#include <algorithm>
+#include "hud.h"
+
+Hud::Hud(const sf::Font &font, int w, int h)
+{
+    width = w;
+    height = h;
+    text.setFont(font);
+    text.setCharacterSize(30);
+    buffer[0] = '\0';
+    winner = -1;
+    teams = false;
+    valid = false;
+}
+
+void Hud::update(const RenderSnapshot &snapshot)
+{
+    int numTeams = snapshot.teamScores.size();
+    if(valid && winner == snapshot.winner && scores == snapshot.teamScores)
+        return;
+
+    winner = snapshot.winner;
+    teams = numTeams < snapshot.numPlayers;
+    scores = snapshot.teamScores;
+    order.resize(numTeams);
+    for (int i = 0; i < numTeams; i++)
+        order[i] = i;
+    valid = true;
+
+    const char *label = teams ? "Team" : "Player";
+    if(winner != -1) //Someone won the game...
+    {
+        snprintf(buffer, BUFFER_SIZE, "%s %d wins\nStart over? (Y/N)", label, winner + 1);
+        text.setPosition(width/2 - 140, height/2 - 40); //Write the text at the middle of the scren
+    }
+    else
+    {
+        //List the best teams, in the order of their numbers
+        int lines = std::min(numTeams, (int)MAX_LINES);
+        if(lines < numTeams)
+        {
+            std::partial_sort(order.begin(), order.begin() + lines, order.end(),
+                              [this](int a, int b) { return scores[a] > scores[b] || (scores[a] == scores[b] && a < b); });
+            std::sort(order.begin(), order.begin() + lines);
+        }
+        int length = 0;
+        for (int i = 0; i < lines && length < BUFFER_SIZE; i++)
+            length += snprintf(buffer + length, BUFFER_SIZE - length, "%s%s %d score: %d", i ? "\n" : "", label, order[i] + 1, scores[order[i]]);
+        text.setPosition(width/2 - 140, height - 35*lines);
+    }
+    text.setString(buffer);
+}
+
+void Hud::draw(sf::RenderTarget &target)
+{
+    target.draw(text);
+}
+
+StatsOverlay::StatsOverlay(const sf::Font &font)
+{
+    text.setFont(font);
+    text.setCharacterSize(16);
+    text.setPosition(10, 8);
+    background.setFillColor(sf::Color(0, 0, 0, 160));
+    background.setPosition(4, 4);
+    buffer[0] = '\0';
+    visible = false;
+    valid = false;
+}
+
+void StatsOverlay::toggle()
+{
+    visible = !visible;
+    valid = false;
+}
+
+//Formats one line of percentiles, in milliseconds
+static int formatTimes(char *out, int size, const char *label, const FrameStats &stats)
+{
+    return snprintf(out, size, "%-7s %6.2f %6.2f %6.2f %6.2f\n", label, stats.getPercentile(0.5) / 1000.0,
+                    stats.getPercentile(0.95) / 1000.0, stats.getPercentile(0.99) / 1000.0, stats.getMax() / 1000.0);
+}
+
+void StatsOverlay::update(const RenderSnapshot &snapshot, const FrameStats &simTime, const FrameStats &renderTime, const FrameStats &frameTime,
+                          const FrameStats &inputLatency)
+{
+    if(!visible || (valid && sinceLayout.getElapsedTime().asMilliseconds() < REFRESH_MS))
+        return;
+    sinceLayout.restart();
+    valid = true;
+
+    int length = snprintf(buffer, BUFFER_SIZE, "ms, last %d frames\n%-7s %6s %6s %6s %6s\n", frameTime.getCount(), "", "p50", "p95", "p99", "max");
+    length += formatTimes(buffer + length, BUFFER_SIZE - length, "tick", simTime);
+    length += formatTimes(buffer + length, BUFFER_SIZE - length, "render", renderTime);
+    length += formatTimes(buffer + length, BUFFER_SIZE - length, "frame", frameTime);
+    length += formatTimes(buffer + length, BUFFER_SIZE - length, "input", inputLatency);
+    snprintf(buffer + length, BUFFER_SIZE - length, "bullets %d  barrels %d  players %d",
+             (int)snapshot.bullets.size(), snapshot.barrels, snapshot.numPlayers);
+    text.setString(buffer);
+    sf::FloatRect bounds = text.getLocalBounds();
+    background.setSize(sf::Vector2f(bounds.left + bounds.width + 12, bounds.top + bounds.height + 12));
+}
+
+void StatsOverlay::draw(sf::RenderTarget &target)
+{
+    if(!visible)
+        return;
+    target.draw(background);
+    target.draw(text);
+}
@@ -0,0 +1,83 @@
+#ifndef HUD_H
+#define HUD_H
+
+#include <vector>
+#include <SFML/Graphics.hpp>
+#include "snapshot.h"
+#include "framestats.h"
+
+//Scoreboard and end of match message. Without teams, every player is listed as a team of its own. The
+//text is formatted and laid out only when a score or the winner changes; the other frames draw the glyph
+//quads that sf::Text keeps from the last layout, so a steady frame does not allocate anything.
+class Hud
+{
+    static const int BUFFER_SIZE = 512; //Enough for MAX_LINES lines
+    static const int MAX_LINES = 8; //If there are more teams, only the best ones are listed
+
+    int width; //Game screen width
+    int height; //Game screen height
+    sf::Text text; //Laid out text of the HUD
+    char buffer[BUFFER_SIZE]; //Formatted text
+    std::vector<int> scores; //Scores shown by the text, one per team
+    std::vector<int> order; //Teams sorted by score
+    bool teams; //true if the teams have more than one player; the text then says "Team" instead of "Player"
+    int winner; //Winner shown by the text, -1 if the match is on
+    bool valid; //false until the text is laid out for the first time
+public:
+    /*
+    @brief
+        Non-default constructor
+    @params
+        font: font of the text, must live as long as the HUD
+        w: game window width
+        h: game window height
+    */
+    Hud(const sf::Font &font, int w, int h);
+
+    //Lays out the text again if the scores or the winner changed since the last call.
+    void update(const RenderSnapshot &snapshot);
+
+    //Draws the text laid out by the last update() call
+    void draw(sf::RenderTarget &target);
+};
+
+//Frame time statistics in the top left corner, toggled with F3. Shows the percentiles of the tick time,
+//of the render and total time of the frames and of the input latency, and the number of entities. The
+//text is laid out a few times a second only, so that the numbers can be read and the overlay itself
+//hardly costs any frame time.
+class StatsOverlay
+{
+    static const int BUFFER_SIZE = 512;
+    static const int REFRESH_MS = 250; //Time between two layouts
+
+    sf::Text text; //Laid out text of the overlay
+    sf::RectangleShape background; //Darkens the battlefield behind the text
+    char buffer[BUFFER_SIZE]; //Formatted text
+    sf::Clock sinceLayout; //Time since the text was laid out
+    bool visible;
+    bool valid; //false until the text is laid out after the overlay was shown
+public:
+    //font: font of the text, must live as long as the overlay
+    StatsOverlay(const sf::Font &font);
+
+    //Shows or hides the overlay
+    void toggle();
+
+    /*
+    @brief
+        Lays out the text again if the overlay is visible and the last layout is older than REFRESH_MS.
+    @params
+        snapshot: tick to count the entities of
+        simTime: time of a simulation tick
+        renderTime: time spent drawing per frame
+        frameTime: time between the ends of two frames
+        inputLatency: time from a key event to the end of the first frame that shows its effect
+    */
+    void update(const RenderSnapshot &snapshot, const FrameStats &simTime, const FrameStats &renderTime, const FrameStats &frameTime,
+                const FrameStats &inputLatency);
+
+    //Draws the overlay if it is visible
+    void draw(sf::RenderTarget &target);
+};
+
+#endif
@@ -0,0 +1,33 @@
+#include <chrono>
+#include "input.h"
+
+InputQueue::InputQueue()
+{
+    head = 0;
+    tail = 0;
+}
+
+bool InputQueue::push(const InputEvent &event)
+{
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if(t - head.load(std::memory_order_acquire) == CAPACITY)
+        return false;
+    events[t % CAPACITY] = event;
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+}
+
+bool InputQueue::pop(InputEvent &event)
+{
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if(h == tail.load(std::memory_order_acquire))
+        return false;
+    event = events[h % CAPACITY];
+    head.store(h + 1, std::memory_order_release);
+    return true;
+}
+
+int64_t InputQueue::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,45 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <atomic>
+#include <cstdint>
+#include "simulation.h"
+
+//A player command read from the keyboard, stamped with the time it was read
+struct InputEvent
+{
+    enum Type {Press,Release,Shoot};
+
+    int64_t time; //InputQueue::now() when the key event was read
+    int player;
+    Type type;
+    Player::WalkDirection dir; //Direction of a Press or Release
+};
+
+//Commands on their way from the window events to the simulation. The window pushes them as the key
+//events arrive, and the game pops them just before a tick, so every command takes effect at a tick
+//boundary no matter when in the frame it came in. One thread pushes and one thread pops, without locks.
+class InputQueue
+{
+public:
+    static const int CAPACITY = 256; //Power of two. Far more key events than a frame ever gets.
+
+private:
+    InputEvent events[CAPACITY];
+    alignas(64) std::atomic<uint32_t> head; //Number of events ever popped, written by the consumer
+    alignas(64) std::atomic<uint32_t> tail; //Number of events ever pushed, written by the producer
+
+public:
+    InputQueue();
+
+    //Appends an event. Returns false if the queue is full, in which case the event is dropped.
+    bool push(const InputEvent &event);
+
+    //Takes the oldest event. Returns false if the queue is empty.
+    bool pop(InputEvent &event);
+
+    //Returns the time stamp for an event, in nanoseconds
+    static int64_t now();
+};
+
+#endif
@@ -0,0 +1,130 @@
+#include <algorithm>
+#include "interest.h"
+
+//The point a soldier is sorted by, the middle of its sprite
+static Coord getCenter(Player &player)
+{
+    Coord pos = player.getPosition();
+    return Coord(pos.x + SOLDIER_SIZE/2, pos.y + SOLDIER_SIZE/2);
+}
+
+InterestGrid::InterestGrid(int width, int height)
+{
+    cols = std::max(1, (width + CELL_WIDTH - 1) / CELL_WIDTH);
+    rows = std::max(1, (height + CELL_HEIGHT - 1) / CELL_HEIGHT);
+    playerStart.assign(cols*rows + 1, 0);
+    bulletStart.assign(cols*rows + 1, 0);
+    entityStart.assign(cols*rows + 1, 0);
+}
+
+void InterestGrid::fill(std::vector<int> &start, std::vector<int> &items)
+{
+    //Count the items in every cell. The count of cell c is stored in start[c+1].
+    start.assign(cols*rows + 1, 0);
+    for (int cell : cells)
+        start[cell + 1]++;
+    for (int c = 0; c < cols*rows; c++)
+        start[c+1] += start[c];
+    items.resize(cells.size());
+    cursor.assign(start.begin(), start.end() - 1);
+    for (size_t i = 0; i < cells.size(); i++)
+        items[cursor[cells[i]]++] = i;
+}
+
+void InterestGrid::setEntities(const World &world)
+{
+    cells.resize(world.getSize());
+    for (int i = 0; i < world.getSize(); i++)
+    {
+        Coord pos = world.getPosition(i);
+        cells[i] = getRow(pos.y)*cols + getColumn(pos.x);
+    }
+    fill(entityStart,entityItems);
+}
+
+void InterestGrid::update(Simulation *sim)
+{
+    Player *players = sim->getPlayers();
+    cells.resize(sim->getNumPlayers());
+    for (int i = 0; i < sim->getNumPlayers(); i++)
+    {
+        Coord pos = getCenter(players[i]);
+        cells[i] = getRow(pos.y)*cols + getColumn(pos.x);
+    }
+    fill(playerStart,playerItems);
+
+    BulletPool *bullets = sim->getBullets();
+    cells.resize(bullets->getCount());
+    for (int i = 0; i < bullets->getCount(); i++)
+    {
+        Coord pos = bullets->getPosition(i);
+        cells[i] = getRow(pos.y)*cols + getColumn(pos.x);
+    }
+    fill(bulletStart,bulletItems);
+}
+
+int InterestGrid::getCols() const
+{
+    return cols;
+}
+
+int InterestGrid::getRows() const
+{
+    return rows;
+}
+
+int InterestGrid::getColumn(float x) const
+{
+    return std::min(std::max((int)(x / CELL_WIDTH), 0), cols - 1);
+}
+
+int InterestGrid::getRow(float y) const
+{
+    return std::min(std::max((int)(y / CELL_HEIGHT), 0), rows - 1);
+}
+
+AreaOfInterest::AreaOfInterest(int range)
+{
+    rangeX = range > 0 ? (range + CELL_WIDTH - 1) / CELL_WIDTH : 0;
+    rangeY = range > 0 ? (range + CELL_HEIGHT - 1) / CELL_HEIGHT : 0;
+    x0 = y0 = x1 = y1 = 0;
+}
+
+void AreaOfInterest::update(const InterestGrid &grid, Simulation *sim, int observer)
+{
+    Player *all = sim->getPlayers();
+    Coord center = getCenter(all[observer]);
+    int col = grid.getColumn(center.x), row = grid.getRow(center.y);
+    //Inner range, where soldiers enter the area
+    int lastCol = grid.getCols() - 1, lastRow = grid.getRows() - 1;
+    int ix0 = 0, iy0 = 0, ix1 = lastCol, iy1 = lastRow;
+    if(rangeX > 0)
+    {
+        ix0 = std::max(col - rangeX, 0);
+        iy0 = std::max(row - rangeY, 0);
+        ix1 = std::min(col + rangeX, lastCol);
+        iy1 = std::min(row + rangeY, lastRow);
+    }
+    //Outer range, where they leave it
+    x0 = std::max(ix0 - HYSTERESIS, 0);
+    y0 = std::max(iy0 - HYSTERESIS, 0);
+    x1 = std::min(ix1 + HYSTERESIS, lastCol);
+    y1 = std::min(iy1 + HYSTERESIS, lastRow);
+
+    inRange.clear();
+    grid.forEachPlayer(x0,y0,x1,y1,[&](int p)
+    {
+        Coord pos = getCenter(all[p]);
+        int c = grid.getColumn(pos.x), r = grid.getRow(pos.y);
+        bool inner = c >= ix0 && c <= ix1 && r >= iy0 && r <= iy1;
+        if(inner || std::binary_search(players.begin(), players.end(), p))
+            inRange.push_back(p);
+    });
+    std::sort(inRange.begin(), inRange.end());
+    players.swap(inRange);
+}
+
+const std::vector<int>& AreaOfInterest::getPlayers() const
+{
+    return players;
+}
@@ -0,0 +1,126 @@
+#ifndef INTEREST_H
+#define INTEREST_H
+
+#include <vector>
+#include "simulation.h"
+
+//Soldiers, bullets and entities of a match sorted into the 60x92 cells of the object grid, so an observer can
+//find the ones near it without looking at all of them (see AreaOfInterest). Every item is in the one cell
+//that holds its reference point. The entities do not move, so they are sorted once; the soldiers and the
+//bullets are sorted again every tick.
+class InterestGrid
+{
+    int cols; //Number of cells in x direction
+    int rows; //Number of cells in y direction
+
+    //Items of cell c are items[start[c]] to items[start[c+1]-1], in the order of their indices
+    std::vector<int> playerStart;
+    std::vector<int> playerItems;
+    std::vector<int> bulletStart;
+    std::vector<int> bulletItems;
+    std::vector<int> entityStart;
+    std::vector<int> entityItems;
+
+    std::vector<int> cells; //Scratch array, cell of every item
+    std::vector<int> cursor; //Scratch array used when filling the cells
+
+    //Sorts the items into their cells with a counting sort
+    void fill(std::vector<int> &start, std::vector<int> &items);
+
+    //Calls f(item) for every item in the cells x0..x1, y0..y1
+    template<typename F>
+    void forEachItem(const std::vector<int> &start, const std::vector<int> &items, int x0, int y0, int x1, int y1, F f) const
+    {
+        for (int y = y0; y <= y1; y++)
+        {
+            for (int k = start[y*cols + x0]; k < start[y*cols + x1 + 1]; k++)
+                f(items[k]);
+        }
+    }
+public:
+    /*
+    @brief
+        Non-default constructor
+    @params
+        width: Battlefield width
+        height: Battlefield height
+    */
+    InterestGrid(int width, int height);
+
+    //Sorts the entities into the cells. Call once, after initWarzone().
+    void setEntities(const World &world);
+
+    //Sorts the soldiers and the bullets of the current tick into the cells
+    void update(Simulation *sim);
+
+    int getCols() const;
+    int getRows() const;
+
+    //Returns the column and the row of the cell a point lies in, clamped to the grid
+    int getColumn(float x) const;
+    int getRow(float y) const;
+
+    //Call f(index) for every soldier, bullet or entity in the cells x0..x1, y0..y1. The ranges must lie
+    //in the grid.
+    template<typename F>
+    void forEachPlayer(int x0, int y0, int x1, int y1, F f) const
+    {
+        forEachItem(playerStart,playerItems,x0,y0,x1,y1,f);
+    }
+
+    template<typename F>
+    void forEachBullet(int x0, int y0, int x1, int y1, F f) const
+    {
+        forEachItem(bulletStart,bulletItems,x0,y0,x1,y1,f);
+    }
+
+    template<typename F>
+    void forEachEntity(int x0, int y0, int x1, int y1, F f) const
+    {
+        forEachItem(entityStart,entityItems,x0,y0,x1,y1,f);
+    }
+};
+
+//What one observer, e.g. the player of a client, needs to know about: the soldiers, bullets and entities
+//within a range of cells around its soldier. A soldier enters the area within the range and only leaves it
+//HYSTERESIS cells further out, so soldiers near the edge do not pop in and out every few ticks. Bullets and
+//entities are taken from the outer range.
+//Updating the area looks only at the cells in range, so its cost depends on how crowded the surroundings
+//are, not on the size of the match.
+class AreaOfInterest
+{
+    int rangeX; //Range in cells to each side, 0 for the whole battlefield
+    int rangeY;
+    std::vector<int> players; //Soldiers in the area, sorted
+    std::vector<int> inRange; //Scratch array
+    //Cells of the outer range at the last update
+    int x0, y0, x1, y1;
+public:
+    static const int HYSTERESIS = 2; //Cells between the range a soldier enters and the range it leaves at
+
+    //The area reaches at least range pixels from the center of the soldier in every direction.
+    //0 covers the whole battlefield.
+    AreaOfInterest(int range = 0);
+
+    //Moves the area to the soldier of the observer and updates the soldiers in it. The observer is always
+    //in its own area.
+    void update(const InterestGrid &grid, Simulation *sim, int observer);
+
+    //Returns the soldiers in the area, sorted
+    const std::vector<int>& getPlayers() const;
+
+    //Call f(index) for every bullet or entity in the outer range of the area
+    template<typename F>
+    void forEachBullet(const InterestGrid &grid, F f) const
+    {
+        grid.forEachBullet(x0,y0,x1,y1,f);
+    }
+
+    template<typename F>
+    void forEachEntity(const InterestGrid &grid, F f) const
+    {
+        grid.forEachEntity(x0,y0,x1,y1,f);
+    }
+};
+
+#endif
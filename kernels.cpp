@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <cstring>
+#include "kernels.h"
+#include "simulation.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define KERNELS_X86
+#include <immintrin.h>
+#endif
+
+//Scalar versions. These are the reference for the others.
+
+static void moveBulletsScalar(float *x, float *y, float *prevX, float *prevY, const float *speed, const unsigned char *dir, int n,
+                              float width, float height, unsigned char *outside)
+{
+    for (int i = 0; i < n; i++)
+    {
+        prevX[i] = x[i];
+        prevY[i] = y[i];
+        if(dir[i] == BulletPool::Up)
+            y[i] -= speed[i];
+        else if(dir[i] == BulletPool::Down)
+            y[i] += speed[i];
+        else if(dir[i] == BulletPool::Left)
+            x[i] -= speed[i];
+        else if(dir[i] == BulletPool::Right)
+            x[i] += speed[i];
+
+        //Same arithmetic as BulletPool::getBounds, so that the same bullets are removed
+        bool horizontal = dir[i] == BulletPool::Left || dir[i] == BulletPool::Right;
+        float left = horizontal ? x[i] - BULLET_LENGTH : x[i];
+        float right = left + (horizontal ? BULLET_LENGTH : BULLET_WIDTH);
+        float bottom = y[i] + (horizontal ? BULLET_WIDTH : BULLET_LENGTH);
+        outside[i] = right < 0 || bottom < 0 || left > width || y[i] > height;
+    }
+}
+
+static int findIntersectionsScalar(const float *left, const float *top, const float *right, const float *bottom, int n,
+                                   float rLeft, float rTop, float rRight, float rBottom, int *found)
+{
+    int count = 0;
+    for (int i = 0; i < n; i++)
+    {
+        //Same as Rect::intersects: the intersection of the two boxes must not be empty
+        if(std::max(left[i], rLeft) < std::min(right[i], rRight) && std::max(top[i], rTop) < std::min(bottom[i], rBottom))
+            found[count++] = i;
+    }
+    return count;
+}
+
+#ifdef KERNELS_X86
+
+//SSE2 versions, 4 bullets or boxes at a time. The directions are turned into lane masks, and each
+//coordinate is picked from the unchanged, decreased and increased value with the masks, so every
+//lane computes exactly what the scalar version computes.
+
+__attribute__((target("sse2")))
+static void moveBulletsSSE2(float *x, float *y, float *prevX, float *prevY, const float *speed, const unsigned char *dir, int n,
+                            float width, float height, unsigned char *outside)
+{
+    const __m128 fzero = _mm_setzero_ps();
+    const __m128 w = _mm_set1_ps(width);
+    const __m128 h = _mm_set1_ps(height);
+    const __m128 length = _mm_set1_ps(BULLET_LENGTH);
+    const __m128 thickness = _mm_set1_ps(BULLET_WIDTH);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i left = _mm_set1_epi32(BulletPool::Left);
+    const __m128i up = _mm_set1_epi32(BulletPool::Up);
+    const __m128i right = _mm_set1_epi32(BulletPool::Right);
+    const __m128i down = _mm_set1_epi32(BulletPool::Down);
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        int packed;
+        memcpy(&packed, dir + i, 4);
+        __m128i d = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+        __m128 isLeft = _mm_castsi128_ps(_mm_cmpeq_epi32(d, left));
+        __m128 isUp = _mm_castsi128_ps(_mm_cmpeq_epi32(d, up));
+        __m128 isRight = _mm_castsi128_ps(_mm_cmpeq_epi32(d, right));
+        __m128 isDown = _mm_castsi128_ps(_mm_cmpeq_epi32(d, down));
+        __m128 s = _mm_loadu_ps(speed + i);
+        __m128 px = _mm_loadu_ps(x + i);
+        __m128 py = _mm_loadu_ps(y + i);
+        _mm_storeu_ps(prevX + i, px);
+        _mm_storeu_ps(prevY + i, py);
+        __m128 keepX = _mm_andnot_ps(_mm_or_ps(isLeft, isRight), px);
+        __m128 keepY = _mm_andnot_ps(_mm_or_ps(isUp, isDown), py);
+        __m128 nx = _mm_or_ps(keepX, _mm_or_ps(_mm_and_ps(isLeft, _mm_sub_ps(px, s)), _mm_and_ps(isRight, _mm_add_ps(px, s))));
+        __m128 ny = _mm_or_ps(keepY, _mm_or_ps(_mm_and_ps(isUp, _mm_sub_ps(py, s)), _mm_and_ps(isDown, _mm_add_ps(py, s))));
+        _mm_storeu_ps(x + i, nx);
+        _mm_storeu_ps(y + i, ny);
+
+        //Edges of the hitboxes, see BulletPool::getBounds
+        __m128 horizontal = _mm_or_ps(isLeft, isRight);
+        __m128 bl = _mm_or_ps(_mm_andnot_ps(horizontal, nx), _mm_and_ps(horizontal, _mm_sub_ps(nx, length)));
+        __m128 br = _mm_add_ps(bl, _mm_or_ps(_mm_andnot_ps(horizontal, thickness), _mm_and_ps(horizontal, length)));
+        __m128 bb = _mm_add_ps(ny, _mm_or_ps(_mm_andnot_ps(horizontal, length), _mm_and_ps(horizontal, thickness)));
+        __m128 out = _mm_or_ps(_mm_or_ps(_mm_cmplt_ps(br, fzero), _mm_cmplt_ps(bb, fzero)),
+                               _mm_or_ps(_mm_cmpgt_ps(bl, w), _mm_cmpgt_ps(ny, h)));
+        int mask = _mm_movemask_ps(out);
+        for (int k = 0; k < 4; k++)
+            outside[i + k] = (mask >> k) & 1;
+    }
+    moveBulletsScalar(x + i, y + i, prevX + i, prevY + i, speed + i, dir + i, n - i, width, height, outside + i);
+}
+
+__attribute__((target("sse2")))
+static int findIntersectionsSSE2(const float *left, const float *top, const float *right, const float *bottom, int n,
+                                 float rLeft, float rTop, float rRight, float rBottom, int *found)
+{
+    const __m128 l = _mm_set1_ps(rLeft);
+    const __m128 t = _mm_set1_ps(rTop);
+    const __m128 r = _mm_set1_ps(rRight);
+    const __m128 b = _mm_set1_ps(rBottom);
+    int count = 0;
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128 inX = _mm_cmplt_ps(_mm_max_ps(_mm_loadu_ps(left + i), l), _mm_min_ps(_mm_loadu_ps(right + i), r));
+        __m128 inY = _mm_cmplt_ps(_mm_max_ps(_mm_loadu_ps(top + i), t), _mm_min_ps(_mm_loadu_ps(bottom + i), b));
+        int mask = _mm_movemask_ps(_mm_and_ps(inX, inY));
+        while(mask)
+        {
+            found[count++] = i + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+    int rest = findIntersectionsScalar(left + i, top + i, right + i, bottom + i, n - i, rLeft, rTop, rRight, rBottom, found + count);
+    for (int k = count; k < count + rest; k++)
+        found[k] += i;
+    return count + rest;
+}
+
+//AVX2 versions, 8 bullets or boxes at a time
+
+__attribute__((target("avx2")))
+static void moveBulletsAVX2(float *x, float *y, float *prevX, float *prevY, const float *speed, const unsigned char *dir, int n,
+                            float width, float height, unsigned char *outside)
+{
+    const __m256 fzero = _mm256_setzero_ps();
+    const __m256 w = _mm256_set1_ps(width);
+    const __m256 h = _mm256_set1_ps(height);
+    const __m256 length = _mm256_set1_ps(BULLET_LENGTH);
+    const __m256 thickness = _mm256_set1_ps(BULLET_WIDTH);
+    const __m256i left = _mm256_set1_epi32(BulletPool::Left);
+    const __m256i up = _mm256_set1_epi32(BulletPool::Up);
+    const __m256i right = _mm256_set1_epi32(BulletPool::Right);
+    const __m256i down = _mm256_set1_epi32(BulletPool::Down);
+    int i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i d = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(dir + i)));
+        __m256 s = _mm256_loadu_ps(speed + i);
+        __m256 px = _mm256_loadu_ps(x + i);
+        __m256 py = _mm256_loadu_ps(y + i);
+        _mm256_storeu_ps(prevX + i, px);
+        _mm256_storeu_ps(prevY + i, py);
+        __m256 isLeft = _mm256_castsi256_ps(_mm256_cmpeq_epi32(d, left));
+        __m256 isRight = _mm256_castsi256_ps(_mm256_cmpeq_epi32(d, right));
+        __m256 nx = _mm256_blendv_ps(px, _mm256_sub_ps(px, s), isLeft);
+        nx = _mm256_blendv_ps(nx, _mm256_add_ps(px, s), isRight);
+        __m256 ny = _mm256_blendv_ps(py, _mm256_sub_ps(py, s), _mm256_castsi256_ps(_mm256_cmpeq_epi32(d, up)));
+        ny = _mm256_blendv_ps(ny, _mm256_add_ps(py, s), _mm256_castsi256_ps(_mm256_cmpeq_epi32(d, down)));
+        _mm256_storeu_ps(x + i, nx);
+        _mm256_storeu_ps(y + i, ny);
+
+        //Edges of the hitboxes, see BulletPool::getBounds
+        __m256 horizontal = _mm256_or_ps(isLeft, isRight);
+        __m256 bl = _mm256_blendv_ps(nx, _mm256_sub_ps(nx, length), horizontal);
+        __m256 br = _mm256_add_ps(bl, _mm256_blendv_ps(thickness, length, horizontal));
+        __m256 bb = _mm256_add_ps(ny, _mm256_blendv_ps(length, thickness, horizontal));
+        __m256 out = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(br, fzero, _CMP_LT_OQ), _mm256_cmp_ps(bb, fzero, _CMP_LT_OQ)),
+                                  _mm256_or_ps(_mm256_cmp_ps(bl, w, _CMP_GT_OQ), _mm256_cmp_ps(ny, h, _CMP_GT_OQ)));
+        int mask = _mm256_movemask_ps(out);
+        for (int k = 0; k < 8; k++)
+            outside[i + k] = (mask >> k) & 1;
+    }
+    moveBulletsSSE2(x + i, y + i, prevX + i, prevY + i, speed + i, dir + i, n - i, width, height, outside + i);
+}
+
+__attribute__((target("avx2")))
+static int findIntersectionsAVX2(const float *left, const float *top, const float *right, const float *bottom, int n,
+                                 float rLeft, float rTop, float rRight, float rBottom, int *found)
+{
+    const __m256 l = _mm256_set1_ps(rLeft);
+    const __m256 t = _mm256_set1_ps(rTop);
+    const __m256 r = _mm256_set1_ps(rRight);
+    const __m256 b = _mm256_set1_ps(rBottom);
+    int count = 0;
+    int i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256 inX = _mm256_cmp_ps(_mm256_max_ps(_mm256_loadu_ps(left + i), l), _mm256_min_ps(_mm256_loadu_ps(right + i), r), _CMP_LT_OQ);
+        __m256 inY = _mm256_cmp_ps(_mm256_max_ps(_mm256_loadu_ps(top + i), t), _mm256_min_ps(_mm256_loadu_ps(bottom + i), b), _CMP_LT_OQ);
+        int mask = _mm256_movemask_ps(_mm256_and_ps(inX, inY));
+        while(mask)
+        {
+            found[count++] = i + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+    int rest = findIntersectionsSSE2(left + i, top + i, right + i, bottom + i, n - i, rLeft, rTop, rRight, rBottom, found + count);
+    for (int k = count; k < count + rest; k++)
+        found[k] += i;
+    return count + rest;
+}
+
+#endif
+
+//The kernels in use
+struct KernelTable
+{
+    Kernels::Level level;
+    void (*moveBullets)(float*, float*, float*, float*, const float*, const unsigned char*, int, float, float, unsigned char*);
+    int (*findIntersections)(const float*, const float*, const float*, const float*, int, float, float, float, float, int*);
+};
+
+static KernelTable makeTable(Kernels::Level level)
+{
+#ifdef KERNELS_X86
+    if(level == Kernels::AVX2)
+        return {level, moveBulletsAVX2, findIntersectionsAVX2};
+    if(level == Kernels::SSE2)
+        return {level, moveBulletsSSE2, findIntersectionsSSE2};
+#endif
+    return {Kernels::Scalar, moveBulletsScalar, findIntersectionsScalar};
+}
+
+static KernelTable selectBest()
+{
+    if(Kernels::isSupported(Kernels::AVX2))
+        return makeTable(Kernels::AVX2);
+    if(Kernels::isSupported(Kernels::SSE2))
+        return makeTable(Kernels::SSE2);
+    return makeTable(Kernels::Scalar);
+}
+
+static KernelTable table = selectBest();
+
+Kernels::Level Kernels::getLevel()
+{
+    return table.level;
+}
+
+bool Kernels::setLevel(Level level)
+{
+    if(!isSupported(level))
+        return false;
+    table = makeTable(level);
+    return true;
+}
+
+bool Kernels::isSupported(Level level)
+{
+#ifdef KERNELS_X86
+    __builtin_cpu_init(); //Needed when called before main(), which is the case for the first selection
+    if(level == AVX2)
+        return __builtin_cpu_supports("avx2");
+    if(level == SSE2)
+        return __builtin_cpu_supports("sse2");
+#endif
+    return level == Scalar;
+}
+
+const char* Kernels::getName(Level level)
+{
+    if(level == AVX2)
+        return "avx2";
+    if(level == SSE2)
+        return "sse2";
+    return "scalar";
+}
+
+void Kernels::moveBullets(float *x, float *y, float *prevX, float *prevY, const float *speed, const unsigned char *dir, int n,
+                          float width, float height, unsigned char *outside)
+{
+    table.moveBullets(x, y, prevX, prevY, speed, dir, n, width, height, outside);
+}
+
+int Kernels::findIntersections(const float *left, const float *top, const float *right, const float *bottom, int n,
+                               float rLeft, float rTop, float rRight, float rBottom, int *found)
+{
+    return table.findIntersections(left, top, right, bottom, n, rLeft, rTop, rRight, rBottom, found);
+}
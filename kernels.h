@@ -0,0 +1,60 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+//Loops over the struct of arrays data of the simulation, written with SIMD instructions. Every kernel has a
+//scalar version and, on x86, an SSE2 and an AVX2 version. The best version the CPU supports is picked when
+//the program starts. All the versions give bit for bit the same results, so the choice does not change
+//the outcome of a match.
+class Kernels
+{
+public:
+    enum Level {Scalar,SSE2,AVX2};
+
+    //Returns the version of the kernels in use
+    static Level getLevel();
+
+    //Switches to another version of the kernels, e.g. to compare them. Returns false if the CPU does not
+    //support it, in which case the version in use is kept. Must not be called while a kernel is running.
+    static bool setLevel(Level level);
+
+    //Returns true if the CPU can run the given version
+    static bool isSupported(Level level);
+
+    //Returns the name of the version, e.g. "avx2"
+    static const char* getName(Level level);
+
+    static const int MIN_BOXES = 8; //Below this many boxes, a plain loop is faster than findIntersections
+
+    /*
+    @brief
+        Moves n bullets one step, and flags the bullets whose hitbox (see BulletPool::getBounds) has left the
+        battlefield. The current positions are copied to prevX and prevY first.
+    @params
+        x, y: bullet positions
+        prevX, prevY: receive the positions before the move
+        speed: distance every bullet moves
+        dir: travel directions, BulletPool::TravelDirection values
+        n: number of bullets
+        width, height: size of the battlefield
+        outside: receives 1 for the bullets that left the battlefield, 0 for the others
+    */
+    static void moveBullets(float *x, float *y, float *prevX, float *prevY, const float *speed, const unsigned char *dir, int n,
+                            float width, float height, unsigned char *outside);
+
+    /*
+    @brief
+        Tests n boxes against one rectangle, with the same rule as Rect::intersects.
+    @params
+        left, top, right, bottom: edges of the boxes; right is left + width, bottom is top + height
+        n: number of boxes
+        rLeft, rTop, rRight, rBottom: edges of the rectangle
+        found: receives the indices of the boxes that intersect the rectangle, in increasing order.
+               Must have room for n indices.
+    @return
+        The number of indices written to found
+    */
+    static int findIntersections(const float *left, const float *top, const float *right, const float *bottom, int n,
+                                 float rLeft, float rTop, float rRight, float rBottom, int *found);
+};
+
+#endif
@@ -1,1481 +1,911 @@
 #include <iostream>
 #include <string>
-#include <sstream>
-#include <random>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
 #include <SFML/Graphics.hpp>
 #include <SFML/System.hpp>
+#include "simulation.h"
+#include "resources.h"
+#include "hud.h"
+#include "replay.h"
+#include "bots.h"
+#include "profiler.h"
+#include "input.h"
+#include "snapshot.h"
+#include "netclient.h"
+#include "rollback.h"
+
+//Keys of a player who plays on the keyboard
+struct KeyBindings
+{
+    sf::Keyboard::Key walk[4]; //Indexed by Player::WalkDirection
+    sf::Keyboard::Key shoot;
+};
 
-class Coord
-{
-public:
-    float x,y;
-    Coord();
-    Coord(float,float);
+//Players 0 and 1 play on the keyboard. The other soldiers of a match get no commands from here.
+static const KeyBindings KEY_BINDINGS[] = {
+    {{sf::Keyboard::Left, sf::Keyboard::Up, sf::Keyboard::Right, sf::Keyboard::Down}, sf::Keyboard::Enter},
+    {{sf::Keyboard::A, sf::Keyboard::W, sf::Keyboard::D, sf::Keyboard::S}, sf::Keyboard::Space},
 };
+static const int MAX_HUMANS = sizeof(KEY_BINDINGS) / sizeof(KEY_BINDINGS[0]);
 
-//Abstract base class. Player, Barrel, Sandbag and Bullet are derived from this class.
-class Object
+//Windowed front end. The match itself is simulated by the Simulation class; this class reads the keyboard,
+//forwards the player commands to the simulation and draws the simulation state.
+//While a match runs, the simulation ticks on a thread of its own and the window thread renders, so a slow
+//frame does not hold up the ticks and a slow tick does not hold up the frames. The threads only share the
+//input queues, the snapshot buffer and the FrameStats; everything else belongs to one of them.
+class Game
 {
-protected:
+    int width; //Game screen width
+    int height; //Game screen height
     sf::RenderWindow* window; //SFML window object
-    sf::Texture texture; //Object texture
-    sf::Sprite sprite; //Object sprite
-    Coord pos; //Object position
+    const sf::Texture *atlas; //Texture that holds all the images
+    sf::IntRect bgRect; //Background tile (grass) image in the atlas
+    sf::IntRect objectRects[World::NUM_TYPES]; //Images of the entity types in the atlas, indexed by World::Type
+    sf::IntRect bulletRect; //Bullet image in the atlas
+    sf::IntRect soldierRects[14]; //Soldier images in the atlas (one element per soldier state)
+    SpriteBatch batch; //Sprites drawn with the next draw call
+    sf::RenderTexture *staticLayer; //Grass, sandbags and barrels composed into one image, see bakeBackground()
+    sf::Sprite staticSprite; //Sprite that draws the static layer to the window
+
+    Hud *hud; //Scoreboard and end of match message
+    StatsOverlay *overlay; //Frame time statistics, toggled with F3
+    FrameStats simTime; //Time of a simulation tick
+    FrameStats renderTime; //Time spent drawing per frame
+    FrameStats frameTime; //Time between the ends of two frames
+    FrameStats inputLatency; //Time from a key event to the end of the first frame that shows its effect
+    InputQueue inputs; //Commands of the players on the keyboard, applied at the next tick
+    InputQueue appliedInputs; //Commands applied to the simulation, handed back to measure the input latency
+    uint32_t inputsApplied; //Number of commands pushed to appliedInputs. Simulation thread only.
+    uint32_t inputsShown; //Number of commands popped from appliedInputs. Render thread only.
+
+    SnapshotBuffer snapshots; //Ticks on their way from the simulation thread to the render thread
+    std::vector<unsigned char> shownAlive; //World::isAlive() of the entities on the static layer
+    std::atomic<bool> running; //Cleared to stop the simulation thread
+    //The simulation thread and the pool record profile events while they tick, so the trace is written by
+    //the simulation thread between two ticks while the render thread waits, see requestTrace()
+    std::atomic<bool> traceRequested;
+    bool traceWritten; //Result of the last trace written
+    std::mutex traceLock;
+    std::condition_variable traceDone;
+
+    Simulation *sim; //Simulation of the match
+    int numHumans; //Number of players controlled with the keyboard, see KEY_BINDINGS
+    Replay *replay; //Replay played back instead of reading the keyboard, null if the match is live
+    float playbackSpeed; //Speed of the playback, 1 is real time
+    HunterBot hunter; //Controller of the players that are not on the keyboard
+    Bots *bots; //Decides for the players that are not on the keyboard, null if there are none
+    NetClient *client; //Server the match is played on, null if it is simulated here
+    RollbackSession *session; //Other peer of a rollback duel, null if there is none
 public:
-
     /*
     @brief
-        Initializes an object
+        Non-default constructor
     @params
-        window: SFML window object
-        texturePath: This is the path to the object texture file
-        pos: Object position
+        s: game speed
+        w: game window width
+        h: game window height
+        nb: number of barrel objects
+        ns: number of sandbag objects
+        np: number of player objects
+        teams: number of teams; player i plays in team i % teams. 0 means every player is a team of its own.
+        maxBullets: maximum number of bullets in flight
+        tickRate: number of simulation ticks per second. Rendering runs at the refresh rate of the display.
+        resources: Texture atlas and font
+        precise: Use pixel exact bullet collisions
     */
-    virtual void init(sf::RenderWindow *window, std::string texturePath, Coord pos);
-
-    //Returns object position
-    Coord getPosition();
+    Game(float s, int w, int h, int nb, int ns, int np, int teams, int maxBullets, int tickRate, Resources &resources, bool precise);
 
-    //Draws the object sprite
-    void paint();
-
-    //Returns object sprite
-    const sf::Sprite getSprite();
-
-    //Make this class abstract
-    virtual ~Object() =0;
-};
-
-class Sandbag: public Object
-{
-
-};
-
-class Barrel: public Object
-{
-    //Visibility of the barrel. 1 is visible, 0 is invisible.
-    int isVisible;
-public:
-    //Inherited function
-    void init(sf::RenderWindow *window, std::string texturePath, Coord pos);
-
-    //Returns isVisible
-    const bool getVisible();
-    //Sets isVisible
-    void setVisible(bool visible);
-};
-
-class Bullet: public Object
-{
-    //Declare BulletList as friend, so it can access the "next" pointer.
-    friend class BulletList;
-
-    float speed; //Speed of the bullet
-    Bullet *next; //Next bullet in the linked list
-public:
-    enum TravelDirection {Left,Up,Right,Down};
-private:
-    TravelDirection dir; //Travel direction of the bullet
-public:
-    //Inherited function
-    void init(sf::RenderWindow *window, std::string texturePath, Coord pos);
-
-    //Moves the sprite in the travel direction, and updates the position accordingly.
-    void move();
-
-    //Sets bullet speed
-    void setSpeed(float speed);
-
-    //Sets the bullet travel direction
-    void setDirection(TravelDirection dir);
-
-    //Returns the bullet travel direction
-    const TravelDirection getDirection();
-};
-
-class Player: public Object
-{
-    sf::Texture textures[14]; //Player texture array (one element per soldier state)
-    int state; //Primary state of the player (range 0-13)
-    int s; //Secondary state variable
-    int score; //Score of the player
-    int respawnFlag; //1 if player needs to respawn, 0 if not. Basically a flag.
-
-public:
-    enum WalkDirection {Left,Up,Right,Down,None};
-private:
-    //Input buffer. This array holds the 2 most recent pressed keys. This ensures a smoother movement,
-    //especially when changing directions.
-    WalkDirection pressedDir[2];
-public:
-
-    //Inherited functions
-    void init(sf::RenderWindow *window, std::string texturePath, Coord pos);
-
-    //Sets player position
-    void setPosition(Coord pos);
+    ~Game();
 
-    /*
-    @brief
-        Checks whether player collides with one of the other objects
-    @params
-        speed: Player movement speed, used when checking boundaries
-        dir: One of the WalkDirection enum values (Left, Up, Right, Down)
-        barrels: Pointer to barrel objects
-        sandbags: Pointer to sandbag objects
-        nb: Number of barrel objects
-        ns: Number of sandbag objects
-    */
-    bool checkCollision(float speed, WalkDirection dir, Barrel *barrels, Sandbag *sandbags, int nb, int ns);
+    //Initializes war zone by determining locations for objects. this function does not draw objects!
+    void initWarzone();
 
-    /*
-    @brief
-        Moves the player around
-    @params
-        speed: Player movement speed
-        dir: One of the WalkDirection enum values (Left, Up, Right, Down)
-        barrels: Pointer to barrel objects
-        nb: Number of barrel objects
-        ns: Number of sandbag objects
-    */
-    void walk(float speed, WalkDirection dir, Barrel *barrels, Sandbag *sandbags, int nb, int ns);
+    //Draws the grass tiles and the entities on the static layer (see shownAlive) that overlap the given region
+    //to the target.
+    void drawStaticObjects(sf::RenderTarget &target, const sf::FloatRect &region);
 
-    //Returns the current travel direction of the player, which is the first element in the pressedDir array.
-    WalkDirection getPressed();
+    //Composes the whole static layer (grass, sandbags, barrels) once, with the entities standing in the
+    //simulation. Called by initWarzone() and startPlayback(), before the simulation thread starts.
+    void bakeBackground();
 
-    //Appends a new direction to the pressedDir array
-    void setPressed(WalkDirection dir);
+    //Redraws only the given region of the static layer, e.g. after a barrel there has been destroyed.
+    void invalidateBackground(const sf::FloatRect &region);
 
-    //Clears the direction from the pressedDir array
-    void clearPressed(WalkDirection dir);
+    //Draws game background, which includes the grasses, sandbags and barrels.
+    //initWarzone() must be called before calling this function!
+    void drawBackground();
 
-    //Returns the state variable
-    const int getState();
+    //Draws the soldiers and the bullets of a snapshot. Their positions are interpolated between the previous
+    //and the current tick; alpha is the fraction of the tick that has passed (0 to 1).
+    void drawObjects(const RenderSnapshot &snapshot, float alpha);
 
-    //Returns true if the soldier is in an appropriate state to shoot. A soldier can only shoot a bullet
-    //if the rifle is pointing up, down, left or right; but not diagonal.
-    const bool canShoot();
+    //Records the match into the replay. Call after initWarzone().
+    void startRecording(Replay *replay);
 
-    //Returns the current score of the player
-    const int getScore();
+    //Plays the replay back from the given tick, at the given speed. The keyboard only controls the window
+    //then. The game must have been created with the settings of the replay. Call after initWarzone().
+    bool startPlayback(Replay *replay, float speed, int tick);
 
-    //Increments score by 1
-    void incrementScore();
+    //Splits the phases of every tick across the threads of the pool
+    void setWorkerPool(WorkerPool *pool);
 
-    int getRespawnFlag();
+    //Turns a key event into commands for the players on the keyboard and queues them for the next tick
+    void readKey(const sf::Event &event);
 
-    void setRespawnFlag(int val);
+    //Applies the queued commands of the players on the keyboard to the simulation. Simulation thread only.
+    void applyInputs();
 
-    void respawn(int* object_grid, int object_grid_width, int object_grid_height);
-};
+    //Hands the current state of the simulation over to the render thread
+    void publish();
 
-class BulletList
-{
-    sf::RenderWindow* window; //SFML window object
-    Bullet *list; //Head of the linked list
-public:
-    BulletList(sf::RenderWindow* window);
+    //Has the simulation thread write the profile to trace.json and waits until it is written. Returns
+    //false if it can not be written. Render thread only.
+    bool requestTrace();
 
-    //Adds a new bullet to the list at the given coordinate and speed.
-    //The state parameter is needed to determine if the bullet needs a 90 degree rotation.
-    void add(Coord pos, int state, float speed);
+    //Writes the profile if the render thread asked for it. Simulation thread only, between two ticks.
+    void serveTrace();
 
-    //Moves every bullet in the list.
-    void update();
+    //Ticks the simulation at the tick rate until running is cleared. Runs on the simulation thread.
+    void simulate();
 
-    //Paints every bullet in the list.
-    void paint();
+    //Draws the newest snapshot and reads the window events until the window is closed or the match is over.
+    //Returns the same as update().
+    int render();
 
-    //Iterates through the linked list and check collision for every bullet. A bullet is destroyed when
-    //it collides with a sandbag, barrel or a soldier.
-    void checkCollision(Player* players, Barrel* barrels, Sandbag* sandbags, int np, int nb, int ns);
+    //Plays the match on a game server instead of simulating it here. The keyboard controls the player the
+    //server gave us. Call instead of initWarzone(); the game must have been created with the settings of the
+    //server.
+    void joinServer(NetClient *client);
 
-    //Deletes the linked list.
-    ~BulletList();
-};
+    //Receives the states of the match from the server until running is cleared, and sends the keyboard
+    //commands. Runs instead of simulate().
+    void followServer();
 
-class Game
-{
-    float speed; //Game speed
-    int numBarrels; //Number of barrel objects
-    int numSandbags; //Number of sandbag objects
-    int numPlayers; //Number of player objects
-    int width; //Game screen width
-    int height; //Game screen height
-    sf::RenderWindow* window; //SFML window object
-    sf::Texture bgTexture; //Background tile (grass) texture
-    sf::Sprite bgSprite; //Background tile (grass) sprite
-    Barrel *barrels; //Pointer to barrel objects
-    Sandbag *sandbags; //Pointer to sandbag objects
-    Player* players; //Pointer to player objects
-
-    sf::Text text; //Text object
-    sf::Font font; //Font object
-
-    BulletList *bullets; //Linked list for bullets
-
-    //Object grid for determining locations for objects. 
-    //When a soldier gets hit, it will respawn somewhere randomly
-    //Thus, we need to keep track of object locations in the map to avoid spawning on top of an object.
-    int object_grid_width;
-    int object_grid_height;
-    int object_grid_size;
-    int *object_grid;
-public:
-    /*
-    @brief
-        Non-default constructor
-    @params
-        s: game speed
-        w: game window width
-        h: game window height
-        nb: number of barrel objects
-        ns: number of sandbag objects
-        np: number of player objects
-    */
-    Game(float s, int w, int h, int nb, int ns, int np);
+    //Plays a duel against another peer, see RollbackSession. The keyboard controls our player. Call instead
+    //of initWarzone(); the game must have been created with the settings of the session.
+    void joinPeer(RollbackSession *session);
 
-    ~Game();
+    //Ticks the duel at the tick rate and handles the commands of the other peer until running is cleared.
+    //Runs instead of simulate().
+    void followPeer();
 
-    //Initializes war zone by determining locations for objects. this function does not draw objects!
-    void initWarzone();
+    //Hands the state of the duel over to the render thread. The end of the match is only shown once it is
+    //confirmed, since a rollback may still take it back.
+    void publishDuel();
 
-    //Draws game background, which includes the grasses, sandbags and barrels.
-    //initWarzone() must be called before calling this function!
-    void drawBackground();
+    //Lets bots play every player that is not on the keyboard. Their decisions are spread over the pool.
+    //Not used during playback, where the recording already holds the commands of the bots.
+    void enableBots(WorkerPool *pool);
 
     //Main game loop. Returns 1 when the game is restarted, returns 0 when the game needs to exit.
     int update();
 };
 
-Coord::Coord()
+Game::Game(float s, int w, int h, int nb, int ns, int np, int teams, int maxBullets, int tickRate, Resources &resources, bool precise)
 {
-    this->x=0;
-    this->y=0;
-}
+    width = w;
+    height = h;
 
-Coord::Coord(float x, float y)
-{
-    this->x=x;
-    this->y=y;
+    window = new sf::RenderWindow(sf::VideoMode(width, height), "Battlefield 3");
+    window->setVerticalSyncEnabled(true); //Render at the refresh rate of the display
+    staticLayer = new sf::RenderTexture;
+    staticLayer->create(width, height);
+    //Look up all the images now, so that drawing never needs to search for them.
+    atlas = &resources.atlas.getTexture();
+    bgRect = resources.atlas.getRect("textures/grass.png");
+    for (int t = 0; t < World::NUM_TYPES; t++)
+        objectRects[t] = resources.atlas.getRect(World::TYPES[t].image);
+    bulletRect = resources.atlas.getRect("textures/bullet.png");
+    for (int i = 0; i < 14; i++)
+    {
+        std::string tmp = "textures/soldier" + std::to_string(i) + ".png";
+        soldierRects[i] = resources.atlas.getRect(tmp);
+    }
+
+    hud = new Hud(resources.font, width, height);
+    overlay = new StatsOverlay(resources.font);
+
+    sim = new Simulation(s,w,h,nb,ns,np,maxBullets,tickRate);
+    sim->setHitboxes(resources.hitboxes);
+    sim->setPreciseCollision(precise);
+    if(teams > 0)
+        sim->setTeams(teams);
+    numHumans = std::min(np, MAX_HUMANS);
+    replay = nullptr;
+    playbackSpeed = 1;
+    bots = nullptr;
+    client = nullptr;
+    session = nullptr;
+    inputsApplied = 0;
+    inputsShown = 0;
+    running = false;
+    traceRequested = false;
+    traceWritten = false;
 }
 
-void Object::init(sf::RenderWindow *window, std::string texturePath, Coord pos)
+Game::~Game()
 {
-    this->window = window;
-    this->pos = pos;
-    texture.loadFromFile(texturePath);
-    sprite.setTexture(texture);
-    sprite.setPosition(pos.x,pos.y);
+    delete bots;
+    delete hud;
+    delete overlay;
+    delete staticLayer;
+    delete window;
+    delete sim;
 }
 
-Coord Object::getPosition()
+void Game::initWarzone()
 {
-    return pos;
+    sim->initWarzone();
+    bakeBackground();
 }
 
-const sf::Sprite Object::getSprite()
+void Game::startRecording(Replay *replay)
 {
-    return sprite;
+    replay->startRecording(sim);
 }
 
-void Object::paint()
+bool Game::startPlayback(Replay *replay, float speed, int tick)
 {
-    window->draw(sprite);
+    if(!replay->seek(sim,tick))
+        return false;
+    this->replay = replay;
+    playbackSpeed = speed;
+    bakeBackground(); //The barrels destroyed before the tick are gone
+    return true;
 }
 
-Object::~Object() {}
-
-void Barrel::init(sf::RenderWindow *window, std::string texturePath, Coord pos)
+void Game::joinServer(NetClient *client)
 {
-    this->window = window;
-    this->pos = pos;
-    texture.loadFromFile(texturePath);
-    sprite.setTexture(texture);
-    sprite.setPosition(pos.x,pos.y);
-    isVisible = 1;
+    this->client = client;
+    numHumans = 1;
+    //The server placed the entities with the same seed
+    sim->setSeed(client->getSettings().seed);
+    initWarzone();
 }
 
-const bool Barrel::getVisible()
+void Game::joinPeer(RollbackSession *session)
 {
-    return isVisible;
+    this->session = session;
+    numHumans = 1;
+    sim->setSeed(session->getSettings().seed);
+    initWarzone();
+    session->start(sim);
 }
 
-void Barrel::setVisible(bool visible)
+void Game::setWorkerPool(WorkerPool *pool)
 {
-    isVisible = visible;
+    sim->setWorkerPool(pool);
 }
 
-void Bullet::init(sf::RenderWindow *window, std::string texturePath, Coord pos)
+void Game::enableBots(WorkerPool *pool)
 {
-    this->window = window;
-    this->pos = pos;
-    texture.loadFromFile(texturePath);
-    sprite.setTexture(texture);
-    sprite.setPosition(pos.x,pos.y);
-
-    //Direction and speed are arbitrary here. 
-    //Use setDirection and setSpeed to change them.
-    dir = Left;
-    speed = 0;
-    next = nullptr;
+    if(numHumans >= sim->getNumPlayers())
+        return;
+    bots = new Bots(pool);
+    for (int i = numHumans; i < sim->getNumPlayers(); i++)
+        bots->setController(i,&hunter);
 }
 
-void Bullet::move()
+void Game::drawStaticObjects(sf::RenderTarget &target, const sf::FloatRect &region)
 {
-    if(dir == Up)
-    {
-        sprite.move(0,-speed);
-        pos.y -= speed;
-    }
-    else if(dir == Down)
+    batch.clear();
+    //draw grasses, unless the image is missing from the atlas, which leaves an empty rect
+    for (int i = 0; bgRect.width > 0 && bgRect.height > 0 && i < width; i+=bgRect.width)
     {
-        sprite.move(0,speed);
-        pos.y += speed;
-    }
-    else if(dir == Left)
-    {
-        sprite.move(-speed,0);
-        pos.x -= speed;
+        for (int j = 0; j < height; j+=bgRect.height)
+        {
+            if(region.intersects(sf::FloatRect(i,j,bgRect.width,bgRect.height)))
+                batch.add(bgRect,i,j);
+        }
     }
-    else if(dir == Right)
+    //draw sandbags and barrels, unless they have been destroyed. The entities do not move after
+    //initWarzone(), so their positions can be read while the simulation thread runs.
+    const World &world = sim->getWorld();
+    for (int i = 0; i < world.getSize(); i++)
     {
-        sprite.move(speed,0);
-        pos.x += speed;
+        const sf::IntRect &rect = objectRects[world.getType(i)];
+        Coord pos = world.getPosition(i);
+        if(shownAlive[i] && region.intersects(sf::FloatRect(pos.x,pos.y,rect.width,rect.height)))
+            batch.add(rect,pos.x,pos.y);
     }
+    batch.draw(target,*atlas);
 }
 
-void Bullet::setSpeed(float speed)
+void Game::bakeBackground()
 {
-    this->speed = speed;
+    const World &world = sim->getWorld();
+    shownAlive.resize(world.getSize());
+    for (int i = 0; i < world.getSize(); i++)
+        shownAlive[i] = world.isAlive(i);
+    staticLayer->clear();
+    drawStaticObjects(*staticLayer, sf::FloatRect(0,0,width,height));
+    staticLayer->display();
+    staticSprite.setTexture(staticLayer->getTexture(),true);
 }
 
-void Bullet::setDirection(TravelDirection dir)
+void Game::invalidateBackground(const sf::FloatRect &region)
 {
-    this->dir = dir;
-    //Rotate the bullet sprite if necessary.
-    if(dir == TravelDirection::Left || dir == TravelDirection::Right)
-        sprite.rotate(90.f);
+    //Map the region to the same pixels of the layer, so nothing outside of it is touched. Objects that
+    //stick out of the region are clipped. The grass tiles cover the whole region, so no clear is needed.
+    sf::View view(region);
+    view.setViewport(sf::FloatRect(region.left/width, region.top/height, region.width/width, region.height/height));
+    staticLayer->setView(view);
+    drawStaticObjects(*staticLayer, region);
+    staticLayer->setView(staticLayer->getDefaultView());
+    staticLayer->display();
 }
 
-const Bullet::TravelDirection Bullet::getDirection()
+void Game::drawBackground()
 {
-    return dir;
+    //One draw call for the whole static layer
+    window->draw(staticSprite);
 }
 
-BulletList::BulletList(sf::RenderWindow* window)
+//Linear interpolation between two positions
+static Coord interpolate(Coord from, Coord to, float alpha)
 {
-    this->window = window;
-    list = nullptr;
+    return Coord(from.x + (to.x - from.x)*alpha, from.y + (to.y - from.y)*alpha);
 }
 
-void BulletList::add(Coord pos, int state, float speed)
+void Game::drawObjects(const RenderSnapshot &snapshot, float alpha)
 {
-    //Determine the bullet direction and position based on soldier's state.
-    //The position is determined so that the bullet comes out from the tip of the rifle.
-    Bullet::TravelDirection bullet_dir;
-    Coord bullet_pos;
-
-    if(state == 0 || state == 7 || state == 8)
-    {
-        bullet_dir = Bullet::Up;
-        bullet_pos.x = pos.x + 60;
-        bullet_pos.y = pos.y - 2 ;
-    }
-    else if(state == 2 || state == 9 || state == 10)
+    batch.clear();
+    //draw soldiers
+    for (const RenderSnapshot::Sprite &soldier : snapshot.soldiers)
     {
-        bullet_dir = Bullet::Right;
-        bullet_pos.x = pos.x + 109;
-        bullet_pos.y = pos.y + 75;
+        Coord pos = interpolate(soldier.prev,soldier.pos,alpha);
+        batch.add(soldierRects[soldier.state],pos.x,pos.y);
     }
-    else if(state == 6 || state == 12 || state == 13)
+    //draw bullets
+    for (const RenderSnapshot::Sprite &bullet : snapshot.bullets)
     {
-        bullet_dir = Bullet::Left;
-        bullet_pos.x = pos.x + 5;
-        bullet_pos.y = pos.y + 38;
-    }
-    else if(state == 3 || state == 4 || state == 11)
-    {
-        bullet_dir = Bullet::Down;
-        bullet_pos.x = pos.x + 30;
-        bullet_pos.y = pos.y + 95;
-    }
-
-    //Now insert the bullet into the linked list.
-    //See if we are inserting to the head of the list.
-    if(list == nullptr)
-    {
-        list = new Bullet;
-        list->init(window,"textures/bullet.png",bullet_pos);
-        list->setDirection(bullet_dir);
-        list->setSpeed(speed);
-    }
-    else
-    {
-        Bullet* tmp_ptr = list;
-        //Find the tail of the list
-        while(tmp_ptr->next != nullptr)
-        {
-            tmp_ptr = tmp_ptr->next;
-        }
-        //Insert to the tail.
-        tmp_ptr->next = new Bullet;
-        tmp_ptr = tmp_ptr->next;
-        tmp_ptr->init(window,"textures/bullet.png",bullet_pos);
-        tmp_ptr->setDirection(bullet_dir);
-        tmp_ptr->setSpeed(speed);
+        //Rotate the bullet sprite if necessary.
+        bool rotate = bullet.state == BulletPool::Left || bullet.state == BulletPool::Right;
+        Coord pos = interpolate(bullet.prev,bullet.pos,alpha);
+        batch.add(bulletRect,pos.x,pos.y,rotate);
     }
+    batch.draw(*window,*atlas);
 }
 
-void BulletList::checkCollision(Player* players, Barrel* barrels, Sandbag* sandbags, int np, int nb, int ns)
+void Game::readKey(const sf::Event &event)
 {
-    Bullet *current;
-    Bullet *previous = nullptr;
-    //We use the sf::Rect::intersects() function to check for collision.
-    sf::Rect<float> bullet_rect; //Rectangle object for bullet
-    sf::Rect<float> object_rect; //Rectangle object for the object
-
-    //Check collision with players first.
-    for (int i = 0; i < np; i++)
-    {
-        object_rect = players[i].getSprite().getGlobalBounds();
-        //Adjust player hitbox based on the state.
-        int player_state = players[i].getState();
-        if(player_state == 0)
-        {
-            object_rect.height = 38;
-            object_rect.width = 40;
-            object_rect.top += 37;
-            object_rect.left += 25;
-        }
-        else if(player_state == 1)
-        {
-            object_rect.height = 38;
-            object_rect.width = 40;
-            object_rect.top += 37;
-            object_rect.left += 25;
-        }
-        else if(player_state == 2)
-        {
-            object_rect.height = 42;
-            object_rect.width = 37;
-            object_rect.top += 37;
-            object_rect.left += 33;
-        }
-        else if(player_state == 3)
-        {
-            object_rect.height = 36;
-            object_rect.width = 45;
-            object_rect.top += 38;
-            object_rect.left += 24;
-        }
-        else if(player_state == 4)
-        {
-            object_rect.height = 35;
-            object_rect.width = 42;
-            object_rect.top += 42;
-            object_rect.left += 26;
-        }
-        else if(player_state == 5)
-        {
-            object_rect.height = 35;
-            object_rect.width = 34;
-            object_rect.top += 42;
-            object_rect.left += 30;
-        }
-        else if(player_state == 6)
-        {
-            object_rect.height = 36;
-            object_rect.width = 36;
-            object_rect.top += 38;
-            object_rect.left += 23;
-        }
-        else if(player_state == 7)
-        {
-            object_rect.height = 37;
-            object_rect.width = 38;
-            object_rect.top += 38;
-            object_rect.left += 26;
-        }
-        else if(player_state == 8)
-        {
-            object_rect.height = 37;
-            object_rect.width = 34;
-            object_rect.top += 41;
-            object_rect.left += 27;
-        }
-        else if(player_state == 9)
-        {
-            object_rect.height = 35;
-            object_rect.width = 34;
-            object_rect.top += 43;
-            object_rect.left += 29;
-        }
-        else if(player_state == 10)
-        {
-            object_rect.height = 35;
-            object_rect.width = 33;
-            object_rect.top += 43;
-            object_rect.left += 32;
-        }
-        else if(player_state == 11)
-        {
-            object_rect.height = 33;
-            object_rect.width = 33;
-            object_rect.top += 42;
-            object_rect.left += 31;
-        }
-        else if(player_state == 12)
-        {
-            object_rect.height = 34;
-            object_rect.width = 37;
-            object_rect.top += 39;
-            object_rect.left += 26;
-        }
-        else if(player_state == 13)
-        {
-            object_rect.height = 34;
-            object_rect.width = 37;
-            object_rect.top += 39;
-            object_rect.left += 26;
-        }
-
-        //Iterate through the bullet list and check for collision with each bullet
-        current = list;
-        while(current != nullptr)
-        {
-            bullet_rect = current->sprite.getGlobalBounds();
-            if(bullet_rect.intersects(object_rect)) //delete bullet if there is collision
-            {
-                if(current == list) //delete head
-                {
-                    list = list->next;
-                    delete current;
-                    current = list;
-                }
-                else
-                {
-                    Bullet *tmp = current;
-                    current = current->next;
-                    delete tmp;
-                    previous->next = current;
-                }
-                //Increment score and respawn
-                if(i == 0)
-                {
-                    players[1].incrementScore();
-                    players[0].setRespawnFlag(1);
-                }
-                    
-                else
-                {
-                    players[0].incrementScore();
-                    players[1].setRespawnFlag(1);
-                }   
-                    
-            }
-            else //next bullet
-            {
-                previous = current;
-                current = current->next;
-            }
-        }
-    }
-    //Check collision with sandbags
-    for (int i = 0; i < ns; i++)
+    //A pressed direction key is appended to the input buffer of the soldier and a released one is removed;
+    //the first direction in the buffer is the one the soldier walks in. Only the key of the event is looked
+    //at, so other keys that are held down are not read again.
+    if(event.type != sf::Event::KeyPressed && event.type != sf::Event::KeyReleased)
+        return;
+    InputEvent input;
+    input.time = InputQueue::now();
+    for (int i = 0; i < numHumans; i++)
     {
-        object_rect = sandbags[i].getSprite().getGlobalBounds();
-        object_rect.height = 70;
-        current = list;
-        while(current != nullptr)
+        const KeyBindings &keys = KEY_BINDINGS[i];
+        input.player = i;
+        for (int dir = Player::Left; dir <= Player::Down; dir++)
         {
-            bullet_rect = current->sprite.getGlobalBounds();
-            if(bullet_rect.intersects(object_rect)) //delete bullet
-            {
-                if(current == list) //delete head
-                {
-                    list = list->next;
-                    delete current;
-                    current = list;
-                }
-                else
-                {
-                    Bullet *tmp = current;
-                    current = current->next;
-                    delete tmp;
-                    previous->next = current;
-                }
-            }
-            else
+            if(event.key.code == keys.walk[dir])
             {
-                previous = current;
-                current = current->next;
+                input.type = event.type == sf::Event::KeyPressed ? InputEvent::Press : InputEvent::Release;
+                input.dir = (Player::WalkDirection)dir;
+                inputs.push(input);
             }
         }
-    }
-
-    //Check collision with barrels.
-    for (int i = 0; i < nb; i++)
-    {
-        object_rect = barrels[i].getSprite().getGlobalBounds();
-        object_rect.height = 70;
-        current = list;
-        while(current != nullptr && barrels[i].getVisible())
+        if(event.key.code == keys.shoot && event.type == sf::Event::KeyPressed)
         {
-            bullet_rect = current->sprite.getGlobalBounds();
-            if(bullet_rect.intersects(object_rect)) //delete bullet
-            {
-                if(current == list) //delete head
-                {
-                    list = list->next;
-                    delete current;
-                    current = list;
-                }
-                else
-                {
-                    Bullet *tmp = current;
-                    current = current->next;
-                    delete tmp;
-                    previous->next = current;
-                }
-                barrels[i].setVisible(false);
-            }
-            else
-            {
-                previous = current;
-                current = current->next;
-            }
+            input.type = InputEvent::Shoot;
+            input.dir = Player::None;
+            inputs.push(input);
         }
     }
 }
 
-void BulletList::update()
-{
-    Bullet *tmp = list;
-    while(tmp != nullptr)
-    {
-        tmp->move();
-        tmp = tmp->next;
-    }
-}
-
-void BulletList::paint()
-{
-    Bullet *current = list;
-    while(current != nullptr)
-    {
-        current->paint();
-        current = current->next;
-    }
-}
-
-BulletList::~BulletList()
-{
-    Bullet *current = list;
-    Bullet *next = nullptr;
-    while(current != nullptr)
-    {
-        next = current->next;
-        delete current;
-        current = next;
-    }
-}
-
-void Player::init(sf::RenderWindow *window, std::string texturePath, Coord pos)
+void Game::applyInputs()
 {
-    this->window = window;
-    this->pos = pos;
-    state = 0;
-    s = 0;
-    score = 0;
-    pressedDir[0] = None;
-    pressedDir[1] = None;
-    for (int i = 0; i < 14; i++)
+    InputEvent input;
+    while(inputs.pop(input))
     {
-        std::string tmp = texturePath + "/soldier" + std::to_string(i) + ".png";
-        textures[i].loadFromFile(tmp);
+        if(input.type == InputEvent::Press)
+            sim->setPressed(input.player,input.dir);
+        else if(input.type == InputEvent::Release)
+            sim->clearPressed(input.player,input.dir);
+        else
+            sim->shoot(input.player);
+        if(appliedInputs.push(input))
+            inputsApplied++;
     }
-    sprite.setTexture(textures[0]);
-    sprite.setPosition(pos.x,pos.y);
 }
 
-void Player::setPosition(Coord pos)
+void Game::publish()
 {
-    this->pos = pos;
+    snapshots.getBack().capture(sim,inputsApplied);
+    snapshots.publish();
 }
 
-void Player::incrementScore()
+bool Game::requestTrace()
 {
-    score++;
+    std::unique_lock<std::mutex> lock(traceLock);
+    traceRequested = true;
+    traceDone.wait(lock, [this]{ return !traceRequested; });
+    return traceWritten;
 }
 
-const int Player::getScore()
+void Game::serveTrace()
 {
-    return score;
+    if(!traceRequested)
+        return;
+    std::lock_guard<std::mutex> lock(traceLock);
+    traceWritten = Profiler::writeTrace("trace.json");
+    traceRequested = false;
+    traceDone.notify_one();
 }
 
-bool Player::checkCollision(float speed, WalkDirection dir, Barrel *barrels, Sandbag *sandbags, int nb, int ns)
+void Game::simulate()
 {
-    if(dir == Up)
+    //The simulation advances in ticks of fixed length. The time that passes is collected in the accumulator,
+    //and a tick is simulated for every full tick length.
+    const sf::Time tickTime = sf::seconds(1.f / (sim->getTickRate() * playbackSpeed));
+    //If the simulation falls behind (e.g. while a tick takes very long), drop the time above this limit
+    //instead of trying to catch up with lots of ticks at once.
+    const sf::Time maxLag = sf::seconds(0.25f);
+    sf::Clock clock;
+    sf::Clock tickClock; //Measures the time of a tick
+    sf::Time accumulator = sf::Time::Zero;
+    while(running)
     {
-        //check collision with barrels
-        for (int i = 0; i < nb; i++)
-        {
-            //check if we are colliding with the barrel. we first check the x-axis, then the y-axis.
-            if(pos.x > barrels[i].getPosition().x - 55 && pos.x < (barrels[i].getPosition().x + 20 ) && barrels[i].getVisible())
-            {
-                if(barrels[i].getPosition().y + 25 > pos.y && barrels[i].getPosition().y < pos.y)
-                    return true;
-            }
-        }
-
-        //check collision with sandbags
-        for (int i = 0; i < ns; i++)
+        serveTrace();
+        accumulator += clock.restart();
+        if(accumulator > maxLag)
+            accumulator = maxLag;
+        while(accumulator >= tickTime && sim->getWinner() == -1 && !(replay && replay->isFinished(sim)))
         {
-            //check if we are colliding with the sandbag. we first check the x-axis, then the y-axis.
-            if(pos.x > sandbags[i].getPosition().x - 55 && pos.x < (sandbags[i].getPosition().x + 30 ) )
+            tickClock.restart();
+            if(replay)
+                replay->applyInputs(sim);
+            else
             {
-                if(sandbags[i].getPosition().y + 35 > pos.y && sandbags[i].getPosition().y < pos.y)
-                    return true;
+                applyInputs();
+                if(bots)
+                    bots->update(sim);
             }
+            sim->tick();
+            publish();
+            simTime.add(tickClock.getElapsedTime().asMicroseconds());
+            accumulator -= tickTime;
         }
-
-        //check if the soldier is out of bounds.
-        return pos.y + 16 - speed < 0;
+        //Sleep until the next tick is due. Once the match is over the time is not used up, so just wait a tick.
+        sf::sleep(accumulator < tickTime ? tickTime - accumulator : tickTime);
     }
-    //Likewise for the other directions... You can play with the numbers to tweak the hitbox of the objects.
-    else if(dir == Right)
-    {
-        for (int i = 0; i < nb; i++)
-        {
-            if(pos.y > barrels[i].getPosition().y - 70 && pos.y < (barrels[i].getPosition().y + 15 ) && barrels[i].getVisible())
-            {
-                if(barrels[i].getPosition().x - 70 < pos.x && barrels[i].getPosition().x > pos.x)
-                    return true;
-            }
-        }
+}
 
-        for (int i = 0; i < ns; i++)
-        {
-            if(pos.y > sandbags[i].getPosition().y - 70 && pos.y < (sandbags[i].getPosition().y + 20 ))
-            {
-                if(sandbags[i].getPosition().x - 80 < pos.x && sandbags[i].getPosition().x > pos.x)
-                    return true;
-            }
-        }
-        //check if the soldier is out of bounds.
-        return pos.x + 90 + speed > window->getSize().x;
-    }
-    else if(dir == Left)
+void Game::followServer()
+{
+    std::deque<InputEvent> sent; //Commands the server has not confirmed yet, for the input latency
+    uint32_t confirmed = 0;
+    while(running)
     {
-        for (int i = 0; i < nb; i++)
+        serveTrace();
+        InputEvent input;
+        bool typed = false;
+        while(inputs.pop(input))
         {
-            if(pos.y > barrels[i].getPosition().y - 70 && pos.y < (barrels[i].getPosition().y + 15 ) && barrels[i].getVisible())
-            {
-                if(barrels[i].getPosition().x + 40 > pos.x && barrels[i].getPosition().x < pos.x)
-                    return true;
-            }
+            InputListener::InputType type = input.type == InputEvent::Press ? InputListener::Press
+                                          : input.type == InputEvent::Release ? InputListener::Release : InputListener::Shoot;
+            client->addCommand(type,input.dir);
+            sent.push_back(input);
+            typed = true;
         }
-
-        for (int i = 0; i < ns; i++)
+        if(typed)
+            client->sendInput();
+        if(!client->receive(2))
+            continue;
+        //The server applied the confirmed commands before the tick of the new state
+        while(confirmed < client->getConfirmed() && !sent.empty())
         {
-            if(pos.y > sandbags[i].getPosition().y - 70 && pos.y < (sandbags[i].getPosition().y + 20 ) )
-            {
-                if(sandbags[i].getPosition().x + 40 > pos.x && sandbags[i].getPosition().x < pos.x)
-                    return true;
-            }
+            if(appliedInputs.push(sent.front()))
+                inputsApplied++;
+            sent.pop_front();
+            confirmed++;
         }
-        //check if the soldier is out of bounds.
-        return pos.x - speed < 0;
+        snapshots.getBack().capture(client,sim,inputsApplied);
+        snapshots.publish();
+        client->sendInput(); //Acknowledges the state
     }
-    else //dir == Down
-    {
-        for (int i = 0; i < nb; i++)
-        {
-            if(pos.x > barrels[i].getPosition().x - 55 && pos.x < (barrels[i].getPosition().x + 20 ) && barrels[i].getVisible())
-            {
-                if(barrels[i].getPosition().y - 80 < pos.y && barrels[i].getPosition().y > pos.y)
-                    return true;
-            }
-        }
+    client->disconnect();
+}
 
-        for (int i = 0; i < ns; i++)
-        {
-            if(pos.x > sandbags[i].getPosition().x - 55 && pos.x < (sandbags[i].getPosition().x + 30 ) )
-            {
-                if(sandbags[i].getPosition().y - 80 < pos.y && sandbags[i].getPosition().y > pos.y)
-                    return true;
-            }
-        }
-        //check if the soldier is out of bounds.
-        return pos.y + 95 + speed > window->getSize().y;
-    }
+void Game::publishDuel()
+{
+    RenderSnapshot &snapshot = snapshots.getBack();
+    snapshot.capture(sim,inputsApplied);
+    if(!session->isConfirmed())
+        snapshot.winner = -1;
+    snapshots.publish();
 }
 
-void Player::walk(float speed, WalkDirection dir, Barrel *barrels, Sandbag *sandbags, int nb, int ns)
+void Game::followPeer()
 {
-    //State machine for the soldier, exactly as shown in the document.
-    switch (state)
+    const sf::Time tickTime = sf::seconds(1.f / sim->getTickRate());
+    const sf::Time maxLag = sf::seconds(0.25f);
+    sf::Clock clock;
+    sf::Clock tickClock; //Measures the time of a tick
+    sf::Time accumulator = sf::Time::Zero;
+    std::vector<InputEvent> queued; //Commands given to the session for the next tick, for the input latency
+    bool shownEnd = false; //The confirmed end of the match has been published
+    while(running)
     {
-    case 0:
-        if(dir == Up && s==1) //walk up
-        {
-            state = 8;
-            sprite.setTexture(textures[state]);
-            if(this->checkCollision(speed,dir,barrels,sandbags,nb,ns))
-                return;
-            sprite.move(0,-speed);
-            pos.y -= speed;
-        }
-        else if(dir == Up && s==0) //walk up
-        {
-            state = 7;
-            sprite.setTexture(textures[state]);
-            if(this->checkCollision(speed,dir,barrels,sandbags,nb,ns))
-                return;
-            sprite.move(0,-speed);
-            pos.y -= speed;
-        }
-        else if(dir == Right || dir == Down) //turn clockwise
-        {
-            state = 1;
-            sprite.setTexture(textures[state]);
-        }
-        else if(dir == Left) //turn counter-clockwise
-        {
-            state = 7;
-            sprite.setTexture(textures[state]);
-        }
-        break;
-
-    case 1:
-        if(dir == Up || dir == Left) //turn counter-clockwise
-        {
-            state = 0;
-            sprite.setTexture(textures[state]);
-        }
-        else if(dir == Down || dir == Right) //turn clockwise
-        {
-            state = 2;
-            sprite.setTexture(textures[state]);
-        }
-        break;
-
-    case 2:
-        if(dir == Right && s==1) //walk right
-        {
-            state = 9;
-            sprite.setTexture(textures[state]);
-            if(this->checkCollision(speed,dir,barrels,sandbags,nb,ns))
-                return;
-            sprite.move(speed,0);
-            pos.x += speed;
-        }
-        else if(dir == Right && s==0) //walk right
-        {
-            state = 10;
-            sprite.setTexture(textures[state]);
-            if(this->checkCollision(speed,dir,barrels,sandbags,nb,ns))
-                return;
-            sprite.move(speed,0);
-            pos.x += speed;
-        }
-        else if(dir == Left || dir == Down) //turn clockwise
+        serveTrace();
+        InputEvent input;
+        while(inputs.pop(input))
         {
-            state = 3;
-            sprite.setTexture(textures[state]);
+            InputListener::InputType type = input.type == InputEvent::Press ? InputListener::Press
+                                          : input.type == InputEvent::Release ? InputListener::Release : InputListener::Shoot;
+            session->addCommand(type,input.dir);
+            queued.push_back(input);
         }
-        else if(dir == Up) //turn counter-clockwise
+        accumulator += clock.restart();
+        if(accumulator > maxLag)
+            accumulator = maxLag;
+        if(accumulator >= tickTime)
         {
-            state = 1;
-            sprite.setTexture(textures[state]);
-        }
-        break;
-
-    case 3:
-        s = 1;
-        if(dir == Down) //Walk down
-        {
-            state = 4;
-            sprite.setTexture(textures[state]);
-            if(this->checkCollision(speed,dir,barrels,sandbags,nb,ns))
-                return;
-            sprite.move(0,speed);
-            pos.y += speed;
+            tickClock.restart();
+            if(session->advance())
+            {
+                for (const InputEvent &applied : queued)
+                {
+                    if(appliedInputs.push(applied))
+                        inputsApplied++;
+                }
+                queued.clear();
+                publishDuel();
+                simTime.add(tickClock.getElapsedTime().asMicroseconds());
+                accumulator -= tickTime;
+            }
+            else //Waiting for the other peer, or the match is over. Try again in a tick.
+                accumulator = sf::Time::Zero;
         }
-        else if(dir == Left || dir == Up) //Turn clockwise
+        //Listen to the other peer until the next tick is due. A rollback counts as simulation time.
+        if(session->receive(std::max(0, (tickTime - accumulator).asMilliseconds())))
         {
-            state = 4;
-            sprite.setTexture(textures[state]);
+            simTime.add(session->getLastRollbackMicros());
+            publishDuel();
         }
-        else if(dir == Right) //turn counter-clockwise
+        if(!shownEnd && sim->getWinner() != -1 && session->isConfirmed())
         {
-            state = 2;
-            sprite.setTexture(textures[state]);
+            shownEnd = true;
+            publishDuel();
         }
-        break;
+    }
+}
 
-    case 4:
-        if(dir == Down && s == 0) //walk down
-        {
-            state = 3;
-            sprite.setTexture(textures[state]);
-            if(this->checkCollision(speed,dir,barrels,sandbags,nb,ns))
-                return;
-            sprite.move(0,speed);
-            pos.y += speed;
-        }
-        else if(dir == Down && s == 1) //walk down
-        {
-            state = 11;
-            sprite.setTexture(textures[state]);
-            if(this->checkCollision(speed,dir,barrels,sandbags,nb,ns))
-                return;
-            sprite.move(0,speed);
-            pos.y += speed;
-        }
-        else if(dir == Left || dir == Up) //turn clockwise
-        {
-            state = 5;
-            sprite.setTexture(textures[state]);
-        }
-        else if(dir == Right) //turn counter-clockwise
-        {
-            state = 3;
-            sprite.setTexture(textures[state]);
-        }
-        break;
+int Game::update()
+{
+    //Something to draw before the first tick
+    if(client)
+        snapshots.getBack().capture(client,sim,inputsApplied);
+    else
+        snapshots.getBack().capture(sim,inputsApplied);
+    snapshots.publish();
+    running = true;
+    std::thread simulation(client ? &Game::followServer : session ? &Game::followPeer : &Game::simulate, this);
+    int result = render();
+    running = false;
+    simulation.join();
+    return result;
+}
 
-    case 5:
-        if(dir == Left || dir == Up) //turn clockwise
-        {
-            state = 6;
-            sprite.setTexture(textures[state]);
-        }
-        else if(dir == Right || dir == Down) //turn counter-clockwise
-        {
-            state = 4;
-            sprite.setTexture(textures[state]);
-        }
-        break;
+int Game::render()
+{
+    const float tickLength = 1e9f / (sim->getTickRate() * playbackSpeed); //In nanoseconds
+    sf::Clock frameClock; //Measures the frame time
+    sf::Clock renderClock; //Measures the render time of a frame
 
-    case 6:
-        if(dir == Left && s == 0) //walk left
-        {
-            state = 13;
-            sprite.setTexture(textures[state]);
-            if(this->checkCollision(speed,dir,barrels,sandbags,nb,ns))
-                return;
-            sprite.move(-speed,0);
-            pos.x -= speed;
-        }
-        else if(dir == Left && s == 1) //walk left
-        {
-            state = 12;
-            sprite.setTexture(textures[state]);
-            if(this->checkCollision(speed,dir,barrels,sandbags,nb,ns))
-                return;
-            sprite.move(-speed,0);
-            pos.x -= speed;
-        }
-        else if(dir == Up || dir == Right) //turn clockwise
+    //Main game loop
+    while (window->isOpen())
+    {
+        PROFILE_SCOPE("frame");
+        sf::Event event;
         {
-            state = 7;
-            sprite.setTexture(textures[state]);
+            PROFILE_SCOPE("input");
+            while (window->pollEvent(event))
+            {
+                if (event.type == sf::Event::Closed)
+                {
+                    return 0; //Return 0 to indicate that the user exited the game.
+                }
+                else if(event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::F3)
+                {
+                    overlay->toggle();
+                }
+                else if(event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::F9)
+                {
+                    //Save what the profiler recorded so far
+                    if(!Profiler::isEnabled())
+                        std::cout << "The profiler is not built in, build with \"make profile\"\n";
+                    else if(requestTrace())
+                        std::cout << "Profile written to trace.json\n";
+                    else
+                        std::cout << "Can not write trace.json\n";
+                }
+                else if(!replay) //The commands of a replay come from the recording
+                {
+                    readKey(event);
+                }
+            }
         }
-        else if(dir == Down) //turn counter-clockwise
+        renderClock.restart();
+        //Take the newest tick, and erase the entities destroyed since the last one from the static layer. A
+        //rollback can also bring back an entity that a mispredicted tick destroyed, so draw those again.
+        if(snapshots.update())
         {
-            state = 5;
-            sprite.setTexture(textures[state]);
+            const RenderSnapshot &snapshot = snapshots.getFront();
+            const World &world = sim->getWorld();
+            for (size_t i = 0; i < shownAlive.size() && i < snapshot.alive.size(); i++)
+            {
+                if(shownAlive[i] != snapshot.alive[i])
+                {
+                    shownAlive[i] = snapshot.alive[i];
+                    const sf::IntRect &rect = objectRects[world.getType(i)];
+                    Coord pos = world.getPosition(i);
+                    invalidateBackground(sf::FloatRect(pos.x,pos.y,rect.width,rect.height));
+                }
+            }
         }
-        break;
+        const RenderSnapshot &snapshot = snapshots.getFront();
+        float alpha = std::max(0.f, std::min(1.f, (InputQueue::now() - snapshot.time) / tickLength));
 
-    case 7:
-        s = 1;
-        if(dir == Up) //walk up
-        {
-            state = 0;
-            sprite.setTexture(textures[state]);
-            if(this->checkCollision(speed,dir,barrels,sandbags,nb,ns))
-                return;
-            sprite.move(0,-speed);
-            pos.y -= speed;
-        }
-        else if(dir == Right) //turn clockwise
-        {
-            state = 0;
-            sprite.setTexture(textures[state]);
-        }
-        else if(dir == Left || dir == Down) //turn counter-clockwise
-        {
-            state = 6;
-            sprite.setTexture(textures[state]);
-        }
-        break;
+        window->clear();
 
-    case 8:
-        state = 0;
-        s = 0;
-        sprite.setTexture(textures[state]);
-        if(dir == Up) //walk up
         {
-            if(this->checkCollision(speed,dir,barrels,sandbags,nb,ns))
-                return;
-            sprite.move(0,-speed);
-            pos.y -= speed;
+            PROFILE_SCOPE("drawBackground");
+            this->drawBackground();
         }
-        break;
-
-    case 9:
-        state = 2;
-        s = 0;
-        sprite.setTexture(textures[state]);
-        if(dir == Right) //walk right
         {
-            if(this->checkCollision(speed,dir,barrels,sandbags,nb,ns))
-                return;
-            sprite.move(speed,0);
-            pos.x += speed;
+            PROFILE_SCOPE("drawObjects");
+            this->drawObjects(snapshot,alpha);
         }
-        break;
-
-    case 10:
-        state = 2;
-        s = 1;
-        sprite.setTexture(textures[state]);
-        if(dir == Right) //walk right
         {
-            if(this->checkCollision(speed,dir,barrels,sandbags,nb,ns))
-                return;
-            sprite.move(speed,0);
-            pos.x += speed;
+            PROFILE_SCOPE("hud");
+            hud->update(snapshot);
+            hud->draw(*window);
+            overlay->update(snapshot,simTime,renderTime,frameTime,inputLatency);
+            overlay->draw(*window);
         }
-        break;
-
-    case 11:
-        state = 4;
-        s = 0;
-        sprite.setTexture(textures[state]);
-        if(dir == Down) //walk down
         {
-            if(this->checkCollision(speed,dir,barrels,sandbags,nb,ns))
-                return;
-            sprite.move(0,speed);
-            pos.y += speed;
+            PROFILE_SCOPE("display");
+            window->display();
         }
-        break;
-
-    case 12:
-        state = 6;
-        s = 0;
-        sprite.setTexture(textures[state]);
-        if(dir == Left) //walk left
+        renderTime.add(renderClock.getElapsedTime().asMicroseconds());
+        frameTime.add(frameClock.restart().asMicroseconds());
+        //The commands applied up to the tick of the snapshot are on the screen now
+        int64_t shown = InputQueue::now();
+        InputEvent input;
+        while(inputsShown != snapshot.inputsApplied && appliedInputs.pop(input))
         {
-            if(this->checkCollision(speed,dir,barrels,sandbags,nb,ns))
-                return;
-            sprite.move(-speed,0);
-            pos.x -= speed;
+            inputLatency.add((shown - input.time) / 1000);
+            inputsShown++;
         }
-        break;
-
-    case 13:
-        state = 6;
-        s = 1;
-        sprite.setTexture(textures[state]);
-        if(dir == Left) //walk left
+        if(snapshot.winner != -1) //Someone won the game...
         {
-            if(this->checkCollision(speed,dir,barrels,sandbags,nb,ns))
-                return;
-            sprite.move(-speed,0);
-            pos.x -= speed;
+            //Wait for a keyboard input
+            sf::Event event;
+            while (1)
+            {
+                while(!window->pollEvent(event));
+                if(event.type == sf::Event::KeyPressed && sf::Keyboard::isKeyPressed(sf::Keyboard::N))
+                    return 0;
+                else if(event.type == sf::Event::KeyPressed && sf::Keyboard::isKeyPressed(sf::Keyboard::Y))
+                    return 1;
+            }
         }
-        break;
-    default:
-        break;
     }
+    return 0;
 }
 
-Player::WalkDirection Player::getPressed()
-{
-    return pressedDir[0];
-}
-
-void Player::setPressed(WalkDirection dir)
-{
-    if(pressedDir[0] == None)
-        pressedDir[0] = dir;
-    else if(pressedDir[1] == None && pressedDir[0] != dir)
-        pressedDir[1] = dir;
-}
-
-void Player::clearPressed(WalkDirection dir)
+//Loads the font and all the images, generates the hitboxes from their alpha channel and packs the images
+//into the atlas. If an image can not be loaded, the built-in hitbox is kept.
+void loadResources(Resources &resources)
 {
-    if(pressedDir[0] == dir)
+    resources.font.loadFromFile("font.ttf"); //SFML prints an error message on failure
+    sf::Image image;
+    if(image.loadFromFile("textures/grass.png"))
+        resources.atlas.add("textures/grass.png",image);
+    if(image.loadFromFile("textures/bullet.png"))
+        resources.atlas.add("textures/bullet.png",image);
+    for (int i = 0; i < 14; i++)
     {
-        pressedDir[0] = pressedDir[1];
-        pressedDir[1] = None;
+        std::string path = "textures/soldier" + std::to_string(i) + ".png";
+        if(image.loadFromFile(path))
+        {
+            resources.atlas.add(path,image);
+            resources.hitboxes.setSoldier(i,image.getPixelsPtr(),image.getSize().x,image.getSize().y);
+        }
     }
-    else if(pressedDir[1] == dir)
+    for (int t = 0; t < World::NUM_TYPES; t++)
     {
-        pressedDir[1] = None;
-    }
-}
-
-const int Player::getState()
-{
-    return state;
-}
-
-const bool Player::canShoot()
-{
-    return (state != 1 && state != 5 && state != 3 && state != 7 && state != 10 && state != 13);
-}
-
-int Player::getRespawnFlag()
-{
-    return respawnFlag;
-}
-
-void Player::setRespawnFlag(int val)
-{
-    respawnFlag = val;
-}
-
-void Player::respawn(int* object_grid, int object_grid_width, int object_grid_height)
-{
-    //Again, mt19937 for generating random coordinates.
-    std::random_device rd{};
-    std::mt19937 gen{rd()};
-
-    std::uniform_int_distribution<int> random_width(0, object_grid_width-1);
-    std::uniform_int_distribution<int> random_height(0, object_grid_height-1);
-
-    while(1)
-    {
-        int coord_x = random_width(gen);
-        int coord_y = random_height(gen);
-        //Convert coordinates to array index
-        int array_index = coord_y == 0 ? object_grid_width*coord_y + coord_x : object_grid_width*(coord_y-1) + coord_x;
-        //See if that location is empty
-        if(object_grid[array_index] != 1)
+        if(image.loadFromFile(World::TYPES[t].image))
         {
-            //Spawn the soldier there.
-            this->pos = Coord(60*coord_x,92*coord_y);
-            sprite.setPosition(pos.x,pos.y);
-            state = 0;
-            s = 0;
-            pressedDir[0] = None;
-            pressedDir[1] = None;        
-            break;
+            resources.atlas.add(World::TYPES[t].image,image);
+            resources.hitboxes.setObject((World::Type)t,image.getPixelsPtr(),image.getSize().x,image.getSize().y);
         }
     }
+    resources.atlas.build();
 }
 
-Game::Game(float s, int w, int h, int nb, int ns, int np)
-{
-    speed = s;
-    width = w;
-    height = h;
-    numBarrels = nb;
-    numSandbags = ns;
-    numPlayers = np;
-
-    window = new sf::RenderWindow(sf::VideoMode(width, height), "Battlefield 3");
-    window->setFramerateLimit(10); //Set frame limit to prevent soldier from sliding while walking
-    bgTexture.loadFromFile("textures/grass.png");
-    bgSprite.setTexture(bgTexture);
-
-    font.loadFromFile("font.ttf");
-    text.setFont(font);
-    text.setCharacterSize(30);
-
-    barrels = new Barrel[nb];
-    sandbags = new Sandbag[ns];
-    players = new Player[np];
-
-    bullets = new BulletList(window);
-
-    object_grid_width = width/60;
-    object_grid_height = height/92;
-    object_grid_size = object_grid_height * object_grid_width;
-    object_grid = new int[object_grid_size]; //2d array, 0 means the cell is empty, 1 means the cell is full.
-    for (int i = 0; i < object_grid_size; i++)
-    {
-        object_grid[i] = 0; //all cells in the grid are initally empty...
-    }    
-}
-
-Game::~Game()
-{
-    delete window;
-    delete[] sandbags;
-    delete[] barrels;
-    delete[] players;
-    delete bullets;
-    delete[] object_grid;
-}
-
-void Game::initWarzone()
+int main(int argc, char **argv)
 {
-    //mt19937 engine for generating random cell coordinates. rand() would also work,
-    //but this is C++ way of doing it.
-    std::random_device rd{};
-    std::mt19937 gen{rd()};
-
-    std::uniform_int_distribution<int> random_width(0, object_grid_width-1);
-    std::uniform_int_distribution<int> random_height(0, object_grid_height-1);
-
-    //randomly spawn sandbags across the field.
-    for (int i = 0; i < numSandbags; i++)
-    {
-        while (1)
-        {
-            //generate random coordinates
-            int coord_x = random_width(gen);
-            int coord_y = random_height(gen);
-            //convert coordinates to an array index
-            int array_index = coord_y == 0 ? object_grid_width*coord_y + coord_x : object_grid_width*(coord_y-1) + coord_x;
-            //check if the generated coordinate is full
-            if(object_grid[array_index] != 1)
-            {
-                sandbags[i].init(window,"textures/bags.png",Coord(60*coord_x,92*coord_y));
-                object_grid[array_index] = 1;
-                break;
-            }
-        }
-    }
-    //randomly spawn barrels across the field. identical to sandbag algorithm.
-    for (int i = 0; i < numBarrels; i++)
-    {
-        while(1)
+    //You can choose arbitrary window size, and arbitrary numbers of sandbags and barrels.
+    //The program should draw the background with no trouble.
+    //If there are more objects than cells, only as many sandbags and barrels are placed as fit.
+    //You can play with the speed, but I found "10" to be working well.
+    //Pass --precise to use pixel exact bullet collisions, and --tick-rate N to change the number of
+    //simulation ticks per second. --players N adds soldiers (only the first two are played on the keyboard,
+    //bots play the others), --teams N splits them into teams.
+    //--record FILE saves every match (the second one to FILE.2 and so on), --replay FILE plays a saved
+    //match back, optionally from --seek TICK and at --replay-speed X times real time.
+    //--connect HOST[:PORT] joins a match hosted by game_server. --peer HOST:PORT --listen PORT --player 0|1
+    //plays a rollback duel against another game; --latency MS holds our datagrams back to test it locally.
+    bool precise = false;
+    int tickRate = Simulation::BASE_TICK_RATE;
+    int numPlayers = 2;
+    int numTeams = 0;
+    std::string recordPath, replayPath, server, peer;
+    int listenPort = 0, peerPlayer = 0, latency = 0;
+    float replaySpeed = 1;
+    int seekTick = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if(arg == "--precise")
+            precise = true;
+        else if(arg == "--tick-rate" && i + 1 < argc)
+            tickRate = std::max(1, std::stoi(argv[++i]));
+        else if(arg == "--players" && i + 1 < argc)
+            numPlayers = std::max(1, std::stoi(argv[++i]));
+        else if(arg == "--teams" && i + 1 < argc)
+            numTeams = std::max(0, std::stoi(argv[++i]));
+        else if(arg == "--record" && i + 1 < argc)
+            recordPath = argv[++i];
+        else if(arg == "--replay" && i + 1 < argc)
+            replayPath = argv[++i];
+        else if(arg == "--replay-speed" && i + 1 < argc)
+            replaySpeed = std::max(0.01f, std::stof(argv[++i]));
+        else if(arg == "--seek" && i + 1 < argc)
+            seekTick = std::stoi(argv[++i]);
+        else if(arg == "--connect" && i + 1 < argc)
+            server = argv[++i];
+        else if(arg == "--peer" && i + 1 < argc)
+            peer = argv[++i];
+        else if(arg == "--listen" && i + 1 < argc)
+            listenPort = std::stoi(argv[++i]);
+        else if(arg == "--player" && i + 1 < argc)
+            peerPlayer = std::stoi(argv[++i]);
+        else if(arg == "--latency" && i + 1 < argc)
+            latency = std::stoi(argv[++i]);
+        else
         {
-            int coord_x = random_width(gen);
-            int coord_y = random_height(gen);
-            int array_index = coord_y == 0 ? object_grid_width*coord_y + coord_x : object_grid_width*(coord_y-1) + coord_x;
-            if(object_grid[array_index] != 1)
-            {
-                barrels[i].init(window,"textures/barrel.png",Coord(60*coord_x,92*coord_y));
-                object_grid[array_index] = 1;
-                break;
-            }
+            std::cout << "Usage: game [--precise] [--tick-rate N] [--players N] [--teams N] [--record FILE]\n"
+                         "       game --replay FILE [--seek TICK] [--replay-speed X]\n"
+                         "       game --connect HOST[:PORT]\n"
+                         "       game --peer HOST:PORT --listen PORT --player 0|1 [--tick-rate N] [--latency MS]\n";
+            return 1;
         }
     }
 
-    //randomly spawn the soldier accross the field.
-    for (int i = 0; i < numPlayers; i++)
+    //The resources are shared by all matches, so they are loaded only once.
+    Resources resources;
+    loadResources(resources);
+    Replay replay;
+    WorkerPool pool; //Threads for the simulation and the bots, shared by all matches
+    Game *gameptr;
+
+    if(!replayPath.empty())
     {
-        while(1)
+        if(!replay.load(replayPath))
         {
-            int coord_x = random_width(gen);
-            int coord_y = random_height(gen);
-            int array_index = coord_y == 0 ? object_grid_width*coord_y + coord_x : object_grid_width*(coord_y-1) + coord_x;
-            if(object_grid[array_index] != 1)
-            {
-                players[i].init(window,"textures",Coord(60*coord_x,92*coord_y));
-                players[i].paint();
-                object_grid[array_index] = 1;
-                break;
-            }
+            std::cout << "Can not read replay " << replayPath << "\n";
+            return 1;
         }
+        const ReplaySettings &settings = replay.getSettings();
+        gameptr = new Game(settings.speed,settings.width,settings.height,settings.barrels,settings.sandbags,
+                           settings.players,settings.teams,settings.maxBullets,settings.tickRate,resources,settings.precise);
+        gameptr->setWorkerPool(&pool);
+        gameptr->initWarzone();
+        if(gameptr->startPlayback(&replay,replaySpeed,seekTick))
+            gameptr->update();
+        else
+            std::cout << "The replay does not fit the simulation\n";
+        delete gameptr;
+        return 0;
     }
 
-    window->display();
-}
-
-void Game::drawBackground()
-{
-    //draw grasses
-    for (int i = 0; i < width; i+=350)
+    if(!server.empty())
     {
-        for (int j = 0; j < height; j+=350)
+        NetClient client;
+        int port = Protocol::DEFAULT_PORT;
+        size_t colon = server.find(':');
+        if(colon != std::string::npos)
         {
-            bgSprite.setPosition(i,j);
-            window->draw(bgSprite);
+            port = std::stoi(server.substr(colon + 1));
+            server.resize(colon);
         }
-    }
-    //draw barrels
-    for (int i = 0; i < numBarrels; i++)
-    {
-        if(barrels[i].getVisible()) //draw the barrel only if it is visible
-            barrels[i].paint();
-        else
+        if(!client.connect(server,port,5000))
         {
-            //Remove the barrel from the object grid
-            int coord_x = (barrels[i].getPosition().x) / 60;
-            int coord_y = (barrels[i].getPosition().y) / 92;
-            //Convert coordinates to an array index
-            int array_index = coord_y == 0 ? object_grid_width*coord_y + coord_x : object_grid_width*(coord_y-1) + coord_x;
-            object_grid[array_index] = 0; 
+            std::cout << "Can not join the server at " << server << ":" << port << "\n";
+            return 1;
         }
+        const ReplaySettings &settings = client.getSettings();
+        gameptr = new Game(settings.speed,settings.width,settings.height,settings.barrels,settings.sandbags,
+                           settings.players,settings.teams,settings.maxBullets,settings.tickRate,resources,settings.precise);
+        gameptr->joinServer(&client);
+        gameptr->update();
+        delete gameptr;
+        return 0;
     }
-    //draw sandbags
-    for (int i = 0; i < numSandbags; i++)
-    {
-        sandbags[i].paint();
-    }
-}
 
-int Game::update()
-{
-    //Use clocks to add a cooldown to shooting bullets. Otherwise, players can spam bullets.
-    sf::Clock clock0, clock1;
-    //Main game loop
-    while (window->isOpen())
+    if(!peer.empty())
     {
-        //Move the soldiers first.
-        for (int i = 0; i < numPlayers; i++)
-        {
-            if(players[i].getPressed() != Player::None)
-                players[i].walk(speed,players[i].getPressed(),barrels,sandbags,numBarrels,numSandbags);
-        }
-        //Check for collision
-        bullets->checkCollision(players,barrels,sandbags,numPlayers,numBarrels,numSandbags);
-        bullets->update();
-
-        sf::Event event;
-        while (window->pollEvent(event))
-        {
-            if (event.type == sf::Event::Closed)
-            {
-                return 0; //Return 0 to indicate that the user exited the game.
-            }
-            else
-            {
-                //We track the KeyPressed and KeyReleased events to ensure smooth movement.
-                //When a KeyPressed event occurs, the key is inserted into the input buffer.
-                //When a KeyReleased event occurs, the key is removed from the input buffer.
-                //The first element in the input buffer determines the travel direction of the soldier.
-                if(event.type == sf::Event::KeyPressed)
-                {
-                    if(sf::Keyboard::isKeyPressed(sf::Keyboard::Up))
-                        players[0].setPressed(Player::Up);
-                    if(sf::Keyboard::isKeyPressed(sf::Keyboard::Down))
-                        players[0].setPressed(Player::Down);
-                    if(sf::Keyboard::isKeyPressed(sf::Keyboard::Right))
-                        players[0].setPressed(Player::Right);
-                    if(sf::Keyboard::isKeyPressed(sf::Keyboard::Left))
-                        players[0].setPressed(Player::Left);
-                    if(sf::Keyboard::isKeyPressed(sf::Keyboard::Enter) && players[0].canShoot() && clock0.getElapsedTime().asMilliseconds() > 100)
-                    {
-                        bullets->add(players[0].getPosition(),players[0].getState(),speed+25);
-                        clock0.restart();
-                    }
-
-                    if(sf::Keyboard::isKeyPressed(sf::Keyboard::W))
-                        players[1].setPressed(Player::Up);
-                    if(sf::Keyboard::isKeyPressed(sf::Keyboard::S))
-                        players[1].setPressed(Player::Down);
-                    if(sf::Keyboard::isKeyPressed(sf::Keyboard::D))
-                        players[1].setPressed(Player::Right);
-                    if(sf::Keyboard::isKeyPressed(sf::Keyboard::A))
-                        players[1].setPressed(Player::Left);
-                    if(sf::Keyboard::isKeyPressed(sf::Keyboard::Space) && players[1].canShoot() && clock1.getElapsedTime().asMilliseconds() > 100)
-                    {
-                        bullets->add(players[1].getPosition(),players[1].getState(),speed+25);
-                        clock1.restart();
-                    }
-
-                }
-                else if(event.type == sf::Event::KeyReleased)
-                {
-                    if(event.key.code == sf::Keyboard::Up)
-                        players[0].clearPressed(Player::Up);
-                    else if(event.key.code == sf::Keyboard::Down)
-                        players[0].clearPressed(Player::Down);
-                    else if(event.key.code == sf::Keyboard::Right)
-                        players[0].clearPressed(Player::Right);
-                    else if(event.key.code == sf::Keyboard::Left)
-                        players[0].clearPressed(Player::Left);
-
-                    else if(event.key.code == sf::Keyboard::W)
-                        players[1].clearPressed(Player::Up);
-                    else if(event.key.code == sf::Keyboard::S)
-                        players[1].clearPressed(Player::Down);
-                    else if(event.key.code == sf::Keyboard::D)
-                        players[1].clearPressed(Player::Right);
-                    else if(event.key.code == sf::Keyboard::A)
-                        players[1].clearPressed(Player::Left);
-                }
-            }
-        }
-        window->clear();
-        
-        this->drawBackground();
-        if(players[0].getRespawnFlag())
+        if(precise)
         {
-            players[0].respawn(object_grid,object_grid_width,object_grid_height);
-            players[0].setRespawnFlag(0);
+            std::cout << "A duel can not use --precise, the other peer may not have the images\n";
+            return 1;
         }
-            
-        if(players[1].getRespawnFlag())
+        RollbackSession session;
+        size_t colon = peer.find(':');
+        if(colon == std::string::npos)
         {
-            players[1].respawn(object_grid,object_grid_width,object_grid_height);
-            players[1].setRespawnFlag(0);
-        }
-        players[0].paint();
-        players[1].paint();        
-        bullets->paint();
-
-        std::stringstream ss;
-        if(players[0].getScore() == 10 || players[1].getScore() == 10) //Someone won the game...
-        {
-            if(players[0].getScore() == 10) //Player 1 wins
-                ss << "Player 1 wins\nStart over? (Y/N)";
-            else //Player 2 wins
-                ss << "Player 2 wins\nStart over? (Y/N)";
-
-            std::string scoreboard = ss.str();
-            text.setPosition(width/2 - 140, height/2 - 40); //Write the text at the middle of the scren
-            text.setString(scoreboard);
-            window->draw(text);
-            window->display();
-            //Wait for a keyboard input
-            sf::Event event;
-            while (1)
-            {
-                while(!window->pollEvent(event));
-                if(event.type == sf::Event::KeyPressed && sf::Keyboard::isKeyPressed(sf::Keyboard::N))
-                    return 0;
-                else if(event.type == sf::Event::KeyPressed && sf::Keyboard::isKeyPressed(sf::Keyboard::Y))
-                    return 1;
-            }
+            std::cout << "Give the peer as HOST:PORT\n";
+            return 1;
         }
-        else
+        int port = std::stoi(peer.substr(colon + 1));
+        peer.resize(colon);
+        //Player 0 decides the match; the seed is random, like in a local match
+        ReplaySettings settings = {10, 1024, 768, 15, 15, 2, 0, 1024, tickRate, false, std::random_device()()};
+        session.setSimulatedLink(latency,0,0);
+        std::cout << "Waiting for the peer at " << peer << ":" << port << "\n";
+        if(!session.connect(peer,port,listenPort,peerPlayer,settings,60000))
         {
-            ss << "Player 1 score: " << players[0].getScore() << "\nPlayer 2 score: " << players[1].getScore();
-            std::string scoreboard = ss.str();
-            text.setPosition(width/2 - 140, height-70);
-            text.setString(scoreboard);
-            window->draw(text);
-            window->display();
+            std::cout << "Can not play against the peer at " << peer << ":" << port
+                      << ": no answer, the same player, or not a two player match without precise collisions\n";
+            return 1;
         }
+        settings = session.getSettings();
+        gameptr = new Game(settings.speed,settings.width,settings.height,settings.barrels,settings.sandbags,
+                           settings.players,settings.teams,settings.maxBullets,settings.tickRate,resources,settings.precise);
+        gameptr->joinPeer(&session);
+        gameptr->update();
+        delete gameptr;
+        return 0;
     }
-    return 0;
-}
 
-int main()
-{
-    //You can choose arbitrary window size, and arbitrary numbers of sandbags and barrels.
-    //The program should draw the background with no trouble.
-    //However, if you choose very large numbers for objects, the program might not start because it might
-    //not be able to find an empty cell for every object.
-    //You can play with the speed, but I found "10" to be working well.
-    Game *gameptr;
+    int match = 1;
     while (1)
     {
-        gameptr = new Game(10,1024,768,15,15,2);
+        gameptr = new Game(10,1024,768,15,15,numPlayers,numTeams,1024,tickRate,resources,precise);
+        gameptr->setWorkerPool(&pool);
         gameptr->initWarzone(); //determine locations for objects
+        gameptr->enableBots(&pool);
+        if(!recordPath.empty())
+            gameptr->startRecording(&replay);
 
-        if(gameptr->update())
-            delete gameptr;
-        else
+        int restart = gameptr->update();
+        if(!recordPath.empty())
         {
-            delete gameptr;
-            break;
+            replay.stopRecording();
+            std::string path = match == 1 ? recordPath : recordPath + "." + std::to_string(match);
+            if(!replay.save(path))
+                std::cout << "Can not write replay " << path << "\n";
         }
+        delete gameptr;
+        if(!restart)
+            break;
+        match++;
     }
     return 0;
 }
 
 //compile commmand for linux
-//g++ main.cpp -lsfml-graphics -lsfml-window -lsfml-system
+//g++ main.cpp simulation.cpp kernels.cpp replay.cpp bots.cpp workers.cpp atlas.cpp hud.cpp framestats.cpp input.cpp snapshot.cpp net.cpp protocol.cpp netclient.cpp rollback.cpp profiler.cpp -pthread -lsfml-graphics -lsfml-window -lsfml-system
@@ -0,0 +1,100 @@
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "net.h"
+
+bool NetAddress::resolve(const std::string &host, int port, NetAddress &address)
+{
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo *result = nullptr;
+    if(getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 || !result)
+        return false;
+    address.ip = ((sockaddr_in*)result->ai_addr)->sin_addr.s_addr;
+    address.port = port;
+    freeaddrinfo(result);
+    return true;
+}
+
+std::string NetAddress::toString() const
+{
+    in_addr addr;
+    addr.s_addr = ip;
+    return std::string(inet_ntoa(addr)) + ":" + std::to_string(port);
+}
+
+UdpSocket::UdpSocket()
+{
+    bytesSent = 0;
+    bytesReceived = 0;
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if(fd != -1)
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+UdpSocket::~UdpSocket()
+{
+    if(fd != -1)
+        close(fd);
+}
+
+bool UdpSocket::bind(int port)
+{
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    return fd != -1 && ::bind(fd, (sockaddr*)&addr, sizeof(addr)) == 0;
+}
+
+bool UdpSocket::send(const NetAddress &to, const unsigned char *data, int size)
+{
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = to.ip;
+    addr.sin_port = htons(to.port);
+    if(fd == -1 || sendto(fd, data, size, 0, (sockaddr*)&addr, sizeof(addr)) != size)
+        return false;
+    bytesSent += size;
+    return true;
+}
+
+int UdpSocket::receive(NetAddress &from, unsigned char *data, int capacity)
+{
+    sockaddr_in addr;
+    socklen_t length = sizeof(addr);
+    int size = fd == -1 ? -1 : recvfrom(fd, data, capacity, 0, (sockaddr*)&addr, &length);
+    if(size < 0)
+        return -1;
+    from.ip = addr.sin_addr.s_addr;
+    from.port = ntohs(addr.sin_port);
+    bytesReceived += size;
+    return size;
+}
+
+bool UdpSocket::wait(int timeoutMs)
+{
+    pollfd p;
+    p.fd = fd;
+    p.events = POLLIN;
+    return fd != -1 && poll(&p, 1, timeoutMs) > 0;
+}
+
+uint64_t UdpSocket::getBytesSent()
+{
+    return bytesSent;
+}
+
+uint64_t UdpSocket::getBytesReceived()
+{
+    return bytesReceived;
+}
@@ -0,0 +1,54 @@
+#ifndef NET_H
+#define NET_H
+
+#include <cstdint>
+#include <string>
+
+//IPv4 address and port of a peer
+struct NetAddress
+{
+    uint32_t ip = 0; //In network byte order
+    uint16_t port = 0; //In host byte order
+
+    bool operator==(const NetAddress &other) const
+    {
+        return ip == other.ip && port == other.port;
+    }
+
+    //Looks up a host name or a dotted address. Returns false if it can not be resolved.
+    static bool resolve(const std::string &host, int port, NetAddress &address);
+
+    //Returns e.g. "127.0.0.1:7777"
+    std::string toString() const;
+};
+
+//Non-blocking UDP socket
+class UdpSocket
+{
+    int fd; //-1 if the socket could not be opened
+    uint64_t bytesSent;
+    uint64_t bytesReceived;
+public:
+    UdpSocket();
+
+    ~UdpSocket();
+
+    //Binds the socket to a local port, 0 for any free port. Returns false on failure.
+    bool bind(int port);
+
+    //Sends a datagram. Returns false if it could not be sent; UDP may also lose it silently.
+    bool send(const NetAddress &to, const unsigned char *data, int size);
+
+    //Takes the next datagram that arrived. Returns its size, or -1 if there is none.
+    int receive(NetAddress &from, unsigned char *data, int capacity);
+
+    //Waits until a datagram arrives or the time runs out. Returns true if one arrived.
+    bool wait(int timeoutMs);
+
+    //Returns the number of bytes sent and received, for bandwidth measurements. UDP and IP headers are not
+    //included.
+    uint64_t getBytesSent();
+    uint64_t getBytesReceived();
+};
+
+#endif
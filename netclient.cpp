@@ -0,0 +1,196 @@
+#include <chrono>
+#include "netclient.h"
+
+NetClient::NetClient()
+{
+    player = -1;
+    settings = ReplaySettings();
+    latest = -1;
+    previous = -1;
+    confirmed = 0;
+    fullStates = 0;
+    deltaStates = 0;
+}
+
+bool NetClient::connect(const std::string &host, int port, int timeoutMs)
+{
+    if(!socket.bind(0) || !NetAddress::resolve(host, port, server))
+        return false;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while(std::chrono::steady_clock::now() < deadline)
+    {
+        //Say hello every 200 ms until the server answers, in case a datagram gets lost
+        packet.clear();
+        writeState(packet, (unsigned char)Protocol::Hello);
+        writeState(packet, Protocol::VERSION);
+        socket.send(server, packet.data(), packet.size());
+        auto retry = std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+        while(std::chrono::steady_clock::now() < retry && socket.wait(50))
+        {
+            NetAddress from;
+            packet.resize(Protocol::MAX_PACKET);
+            int size = socket.receive(from, packet.data(), packet.size());
+            if(size <= 0 || !(from == server))
+                continue;
+            packet.resize(size);
+            size_t offset = 1;
+            uint32_t version;
+            if(packet[0] == Protocol::Reject)
+                return false;
+            if(packet[0] == Protocol::Welcome && readState(packet, offset, version) && version == Protocol::VERSION
+               && readState(packet, offset, player) && readState(packet, offset, settings))
+            {
+                //A broken server could make us build a simulation we can not hold
+                return settings.isValid() && player >= 0 && player < settings.players;
+            }
+        }
+    }
+    return false;
+}
+
+void NetClient::disconnect()
+{
+    unsigned char bye = Protocol::Bye;
+    socket.send(server, &bye, 1);
+}
+
+const ReplaySettings& NetClient::getSettings()
+{
+    return settings;
+}
+
+int NetClient::getPlayer()
+{
+    return player;
+}
+
+void NetClient::addCommand(InputListener::InputType type, Player::WalkDirection dir)
+{
+    unconfirmed.push_back({(unsigned char)type, (unsigned char)dir});
+}
+
+void NetClient::sendInput()
+{
+    packet.clear();
+    writeState(packet, (unsigned char)Protocol::Input);
+    writeState(packet, latest);
+    writeState(packet, confirmed);
+    int count = std::min((int)unconfirmed.size(), (int)Protocol::MAX_COMMANDS);
+    writeVarint(packet, count);
+    writeState(packet, unconfirmed.data(), count);
+    socket.send(server, packet.data(), packet.size());
+}
+
+bool NetClient::receive(int timeoutMs)
+{
+    bool updated = false;
+    if(!socket.wait(timeoutMs))
+        return false;
+    NetAddress from;
+    while(1)
+    {
+        packet.resize(Protocol::MAX_PACKET);
+        int size = socket.receive(from, packet.data(), packet.size());
+        if(size < 0)
+            break;
+        packet.resize(size);
+        if(size == 0 || !(from == server) || packet[0] != Protocol::Snapshot)
+            continue;
+        size_t offset = 1;
+        int tick, baseTick;
+        uint32_t applied;
+        if(!readState(packet, offset, tick) || !readState(packet, offset, baseTick) || !readState(packet, offset, applied)
+           || tick <= latest || tick < 0 || baseTick < -1 || baseTick >= tick)
+            continue; //Broken, or older than what we have
+        const NetState *base = nullptr;
+        if(baseTick != -1)
+        {
+            base = &history[baseTick % HISTORY];
+            if(base->tick != baseTick)
+                continue; //We no longer have the base
+        }
+        NetState state;
+        if(!state.decode(base, packet, offset) || state.numPlayers != settings.players || state.numTeams != settings.teams
+           || state.numEntities > settings.barrels + settings.sandbags)
+            continue;
+        //Keep what the state tells about the rest of the match
+        if((int)alive.size() != state.numEntities)
+            alive.assign(state.numEntities, 1);
+        for (int entity : state.destroyed)
+            alive[entity] = 0;
+        teamScores.resize(state.numTeams, 0);
+        for (const NetState::Score &score : state.scores)
+            teamScores[score.team] = score.score;
+        state.tick = tick;
+        (base ? deltaStates : fullStates)++;
+        history[tick % HISTORY] = std::move(state);
+        previous = latest;
+        latest = tick;
+        //Forget the commands the server has applied
+        if(applied > confirmed)
+        {
+            unconfirmed.erase(unconfirmed.begin(), unconfirmed.begin() + std::min<size_t>(applied - confirmed, unconfirmed.size()));
+            confirmed = applied;
+        }
+        updated = true;
+    }
+    return updated;
+}
+
+const NetState& NetClient::getState()
+{
+    static const NetState empty;
+    return latest == -1 ? empty : history[latest % HISTORY];
+}
+
+const NetState* NetClient::getPreviousState()
+{
+    if(previous == -1 || history[previous % HISTORY].tick != previous)
+        return nullptr;
+    return &history[previous % HISTORY];
+}
+
+const std::vector<unsigned char>& NetClient::getAlive()
+{
+    return alive;
+}
+
+const std::vector<int>& NetClient::getTeamScores()
+{
+    return teamScores;
+}
+
+int NetClient::getWinner()
+{
+    for (size_t i = 0; i < teamScores.size(); i++)
+    {
+        if(teamScores[i] >= Simulation::WINNING_SCORE)
+            return i;
+    }
+    return -1;
+}
+
+uint32_t NetClient::getConfirmed()
+{
+    return confirmed;
+}
+
+uint64_t NetClient::getBytesReceived()
+{
+    return socket.getBytesReceived();
+}
+
+uint64_t NetClient::getBytesSent()
+{
+    return socket.getBytesSent();
+}
+
+long NetClient::getFullStates()
+{
+    return fullStates;
+}
+
+long NetClient::getDeltaStates()
+{
+    return deltaStates;
+}
@@ -0,0 +1,82 @@
+#ifndef NETCLIENT_H
+#define NETCLIENT_H
+
+#include <string>
+#include <vector>
+#include "net.h"
+#include "protocol.h"
+
+//Client side of a match hosted by game_server. Sends the commands of one player and receives what it sees
+//of the match every tick. What the states tell about the entities and the scores is kept, since a state
+//only carries the changes. Commands are sent again with every message until the server confirms them, so a
+//lost datagram only delays them. The client acknowledges every state it receives, and the server sends the
+//next one as a delta against the newest acknowledged one.
+class NetClient
+{
+    static const int HISTORY = 64; //Received states kept as delta bases, must match the server
+
+    UdpSocket socket;
+    NetAddress server;
+    int player; //Player the server gave us
+    ReplaySettings settings;
+    NetState history[HISTORY]; //Received states, indexed by tick % HISTORY
+    int latest; //Tick of the newest state, -1 before the first one
+    int previous; //Tick of the state before it, -1 if there is none
+    std::vector<unsigned char> alive; //World::isAlive() of every entity, as far as we know
+    std::vector<int> teamScores; //Score of every team
+    std::vector<Protocol::Command> unconfirmed; //Commands the server has not confirmed yet
+    uint32_t confirmed; //Number of commands the server confirmed
+    std::vector<unsigned char> packet; //Scratch buffer
+    long fullStates; //Number of states received in full
+    long deltaStates; //Number of states received as a delta
+public:
+    NetClient();
+
+    //Asks the server for a player. Returns false if the server does not answer in time, rejects us or sends
+    //settings no match can be built with (see ReplaySettings::isValid).
+    bool connect(const std::string &host, int port, int timeoutMs);
+
+    //Tells the server that we leave
+    void disconnect();
+
+    //Returns the settings of the match
+    const ReplaySettings& getSettings();
+
+    //Returns the player we play
+    int getPlayer();
+
+    //Queues a command, see InputListener::InputType. It is sent with the next sendInput().
+    void addCommand(InputListener::InputType type, Player::WalkDirection dir);
+
+    //Sends the unconfirmed commands and acknowledges the newest state
+    void sendInput();
+
+    //Waits up to timeoutMs for messages and handles all that arrived. Returns true if a newer state arrived.
+    bool receive(int timeoutMs);
+
+    //Returns the newest state. Empty (tick -1) before the first one.
+    const NetState& getState();
+
+    //Returns the state received before the newest one, or null
+    const NetState* getPreviousState();
+
+    //Returns whether each entity stands. Entities outside of our area of interest are as we last saw them.
+    const std::vector<unsigned char>& getAlive();
+
+    //Returns the score of every team. Empty before the first state.
+    const std::vector<int>& getTeamScores();
+
+    //Returns the winning team, or -1 if the match is on. See Simulation::getWinner.
+    int getWinner();
+
+    //Returns the number of commands the server applied so far
+    uint32_t getConfirmed();
+
+    //Traffic, for bandwidth measurements
+    uint64_t getBytesReceived();
+    uint64_t getBytesSent();
+    long getFullStates();
+    long getDeltaStates();
+};
+
+#endif
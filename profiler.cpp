@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "profiler.h"
+
+namespace
+{
+    struct Event
+    {
+        const char *name;
+        int64_t start;
+        int64_t end;
+    };
+
+    //Events of one thread. Only the owning thread writes; count tells writeTrace() how far it got.
+    struct ThreadBuffer
+    {
+        int id; //Thread number in the trace, in the order the threads first recorded
+        bool main; //Recorded by the thread that started the program
+        Event events[Profiler::BUFFER_SIZE];
+        std::atomic<uint64_t> count; //Number of events ever recorded, the newest is at (count-1) % BUFFER_SIZE
+    };
+
+    //Static initialization runs on the main thread
+    const std::thread::id mainThread = std::this_thread::get_id();
+
+    std::mutex registryLock;
+    //Buffers of all the threads that ever recorded. They are never freed, so the events of a thread that has
+    //ended still show up in the trace.
+    std::vector<ThreadBuffer*> buffers;
+
+    ThreadBuffer* getBuffer()
+    {
+        thread_local ThreadBuffer *buffer = nullptr;
+        if(!buffer)
+        {
+            buffer = new ThreadBuffer;
+            buffer->count = 0;
+            buffer->main = std::this_thread::get_id() == mainThread;
+            std::lock_guard<std::mutex> lock(registryLock);
+            buffer->id = buffers.size();
+            buffers.push_back(buffer);
+        }
+        return buffer;
+    }
+}
+
+bool Profiler::isEnabled()
+{
+#ifdef ENABLE_PROFILER
+    return true;
+#else
+    return false;
+#endif
+}
+
+int64_t Profiler::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::record(const char *name, int64_t start, int64_t end)
+{
+    ThreadBuffer *buffer = getBuffer();
+    uint64_t n = buffer->count.load(std::memory_order_relaxed);
+    buffer->events[n % BUFFER_SIZE] = {name, start, end};
+    buffer->count.store(n + 1, std::memory_order_release);
+}
+
+bool Profiler::writeTrace(const std::string &path)
+{
+    if(!isEnabled())
+        return false;
+    std::ofstream out(path);
+    if(!out)
+        return false;
+
+    std::lock_guard<std::mutex> lock(registryLock);
+    //Time stamps are written relative to the oldest event, in microseconds with all three decimals, so
+    //phases of a few nanoseconds still line up after seconds of recording
+    int64_t origin = INT64_MAX;
+    for (ThreadBuffer *buffer : buffers)
+    {
+        uint64_t count = buffer->count.load(std::memory_order_acquire);
+        for (uint64_t i = count > BUFFER_SIZE ? count - BUFFER_SIZE : 0; i < count; i++)
+            origin = std::min(origin, buffer->events[i % BUFFER_SIZE].start);
+    }
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+    for (ThreadBuffer *buffer : buffers)
+    {
+        out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id
+            << ",\"args\":{\"name\":\"" << (buffer->main ? "main" : "thread " + std::to_string(buffer->id)) << "\"}}";
+        first = false;
+        uint64_t count = buffer->count.load(std::memory_order_acquire);
+        for (uint64_t i = count > BUFFER_SIZE ? count - BUFFER_SIZE : 0; i < count; i++)
+        {
+            const Event &e = buffer->events[i % BUFFER_SIZE];
+            out << ",\n{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id
+                << ",\"ts\":" << (e.start - origin) / 1000.0 << ",\"dur\":" << (e.end - e.start) / 1000.0 << "}";
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return (bool)out;
+}
@@ -0,0 +1,59 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+#include <string>
+
+//Scoped timers for the phases of a frame. Put PROFILE_SCOPE("name") at the top of a block, and the time
+//until the end of the block is recorded on the calling thread. Every thread records into its own ring
+//buffer, so recording takes no lock; once a buffer is full the oldest events are overwritten.
+//writeTrace() saves the events in the Chrome trace event format, which chrome://tracing and Perfetto open.
+//
+//The timers only exist in builds with -DENABLE_PROFILER (see "make profile"). Otherwise PROFILE_SCOPE
+//expands to nothing and the instrumented code is exactly what it would be without it.
+class Profiler
+{
+public:
+    static const int BUFFER_SIZE = 1 << 16; //Events kept per thread
+
+    //Returns true if the program was built with the profiler
+    static bool isEnabled();
+
+    //Returns a time stamp in nanoseconds
+    static int64_t now();
+
+    //Records an event on the calling thread. name must be a string literal, only the pointer is kept.
+    static void record(const char *name, int64_t start, int64_t end);
+
+    //Writes the recorded events of all threads to the file. Call it while no thread is recording, e.g.
+    //between two frames. Returns false if the file can not be written or the profiler is not built in.
+    static bool writeTrace(const std::string &path);
+};
+
+//Records the time from its construction to the end of the scope
+class ProfileScope
+{
+    const char *name;
+    int64_t start;
+public:
+    ProfileScope(const char *name)
+    {
+        this->name = name;
+        start = Profiler::now();
+    }
+
+    ~ProfileScope()
+    {
+        Profiler::record(name, start, Profiler::now());
+    }
+};
+
+#ifdef ENABLE_PROFILER
+#define PROFILE_CONCAT_(a,b) a##b
+#define PROFILE_CONCAT(a,b) PROFILE_CONCAT_(a,b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope,__LINE__)(name)
+#else
+#define PROFILE_SCOPE(name)
+#endif
+
+#endif
@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <cmath>
+#include "protocol.h"
+
+const uint32_t Protocol::VERSION;
+
+//Largest match a state may describe, so a broken size can not make the client allocate without bounds
+static const uint32_t MAX_ITEMS = 1 << 24;
+
+//Rounds a coordinate to a whole pixel
+static uint16_t quantize(float value)
+{
+    return (uint16_t)std::max(0.f, std::min(65535.f, std::round(value)));
+}
+
+static void writeBytes(std::vector<unsigned char> &buffer, uint16_t x, uint16_t y, uint8_t last)
+{
+    unsigned char bytes[5] = {(unsigned char)x, (unsigned char)(x >> 8), (unsigned char)y, (unsigned char)(y >> 8), last};
+    buffer.insert(buffer.end(), bytes, bytes + 5);
+}
+
+//Reads the 5 bytes written by writeBytes. Returns false if the buffer is too short.
+static bool readBytes(const std::vector<unsigned char> &buffer, size_t &offset, uint16_t &x, uint16_t &y, uint8_t &last)
+{
+    if(buffer.size() - offset < 5)
+        return false;
+    const unsigned char *in = buffer.data() + offset;
+    x = in[0] | in[1] << 8;
+    y = in[2] | in[3] << 8;
+    last = in[4];
+    offset += 5;
+    return true;
+}
+
+NetState::NetState()
+{
+    tick = -1;
+    numPlayers = 0;
+    numEntities = 0;
+    numTeams = 0;
+}
+
+void NetState::addSoldier(Simulation *sim, int player)
+{
+    Player &p = sim->getPlayers()[player];
+    Coord pos = p.getPosition();
+    players.push_back(player);
+    soldiers.push_back({quantize(pos.x), quantize(pos.y), (uint8_t)p.getState()});
+}
+
+void NetState::addBullet(Simulation *sim, int bullet)
+{
+    BulletPool *pool = sim->getBullets();
+    Coord pos = pool->getPosition(bullet);
+    bullets.push_back({quantize(pos.x), quantize(pos.y), (uint8_t)pool->getDirection(bullet)});
+}
+
+void NetState::encode(const NetState *base, std::vector<unsigned char> &buffer, size_t maxSize) const
+{
+    size_t start = buffer.size();
+    writeVarint(buffer, numPlayers);
+    writeVarint(buffer, numEntities);
+    writeVarint(buffer, numTeams);
+
+    //Every soldier is the gap to the previous index and a bit telling whether it changed since the base;
+    //only the changed ones are followed by their state. The base is walked along, both lists are sorted.
+    writeVarint(buffer, players.size());
+    size_t k = 0;
+    int last = -1;
+    for (size_t i = 0; i < players.size(); i++)
+    {
+        const Soldier &s = soldiers[i];
+        while(base && k < base->players.size() && base->players[k] < players[i])
+            k++;
+        bool same = base && k < base->players.size() && base->players[k] == players[i] && base->soldiers[k].x == s.x
+                    && base->soldiers[k].y == s.y && base->soldiers[k].state == s.state;
+        writeVarint(buffer, (uint32_t)(players[i] - last - 1) << 1 | !same);
+        if(!same)
+            writeBytes(buffer, s.x, s.y, s.state);
+        last = players[i];
+    }
+
+    writeVarint(buffer, destroyed.size());
+    last = -1;
+    for (int entity : destroyed)
+    {
+        writeVarint(buffer, entity - last - 1);
+        last = entity;
+    }
+
+    writeVarint(buffer, scores.size());
+    for (const Score &score : scores)
+    {
+        writeVarint(buffer, score.team);
+        writeVarint(buffer, score.score);
+    }
+
+    //As many bullets as fit
+    size_t room = maxSize - std::min(maxSize, buffer.size() - start + 5);
+    uint32_t count = std::min(bullets.size(), room / 5);
+    writeVarint(buffer, count);
+    for (uint32_t j = 0; j < count; j++)
+        writeBytes(buffer, bullets[j].x, bullets[j].y, bullets[j].dir);
+}
+
+bool NetState::decode(const NetState *base, const std::vector<unsigned char> &buffer, size_t &offset)
+{
+    tick = -1;
+    players.clear();
+    soldiers.clear();
+    bullets.clear();
+    destroyed.clear();
+    scores.clear();
+    uint32_t np, ne, nt, count;
+    if(!readVarint(buffer, offset, np) || !readVarint(buffer, offset, ne) || !readVarint(buffer, offset, nt)
+       || np > MAX_ITEMS || ne > MAX_ITEMS || nt > np)
+        return false;
+    numPlayers = np;
+    numEntities = ne;
+    numTeams = nt;
+
+    //Every item takes at least a byte, so a count larger than the rest of the buffer is broken
+    if(!readVarint(buffer, offset, count) || count > buffer.size() - offset)
+        return false;
+    size_t k = 0;
+    int64_t last = -1;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t code;
+        if(!readVarint(buffer, offset, code))
+            return false;
+        int64_t player = last + 1 + (code >> 1);
+        if(player >= numPlayers)
+            return false;
+        Soldier s;
+        if(code & 1)
+        {
+            if(!readBytes(buffer, offset, s.x, s.y, s.state))
+                return false;
+        }
+        else
+        {
+            //Unchanged, take it from the base
+            while(base && k < base->players.size() && base->players[k] < player)
+                k++;
+            if(!base || k == base->players.size() || base->players[k] != player)
+                return false;
+            s = base->soldiers[k];
+        }
+        players.push_back(player);
+        soldiers.push_back(s);
+        last = player;
+    }
+
+    if(!readVarint(buffer, offset, count) || count > buffer.size() - offset)
+        return false;
+    last = -1;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t gap;
+        if(!readVarint(buffer, offset, gap) || last + 1 + gap >= numEntities)
+            return false;
+        last += 1 + gap;
+        destroyed.push_back(last);
+    }
+
+    if(!readVarint(buffer, offset, count) || count > buffer.size() - offset)
+        return false;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t team, score;
+        if(!readVarint(buffer, offset, team) || !readVarint(buffer, offset, score) || team >= nt || score > INT32_MAX)
+            return false;
+        scores.push_back({(int)team, (int)score});
+    }
+
+    if(!readVarint(buffer, offset, count) || count > (buffer.size() - offset) / 5)
+        return false;
+    bullets.resize(count);
+    for (Bullet &b : bullets)
+        readBytes(buffer, offset, b.x, b.y, b.dir);
+    return true;
+}
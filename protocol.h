@@ -0,0 +1,94 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <cstdint>
+#include <vector>
+#include "simulation.h"
+#include "replay.h"
+
+//Messages between the game server and its clients. Every datagram starts with a MessageType byte; values
+//are written with writeState, so server and clients must have the same byte order.
+//
+//client -> server  Hello:    version
+//server -> client  Welcome:  version, player, ReplaySettings of the match
+//server -> client  Reject:   version (the server is full or speaks another version)
+//client -> server  Input:    last tick received, number of commands before the first one sent, commands
+//server -> client  Snapshot: tick, tick of the delta base or -1, number of commands applied, NetState
+//client -> server  Bye
+class Protocol
+{
+public:
+    enum MessageType {Hello,Welcome,Reject,Input,Snapshot,Bye};
+
+    static const uint32_t VERSION = 2;
+    static const int DEFAULT_PORT = 7777;
+    static const int MAX_PACKET = 65000; //Largest datagram sent; UDP allows a little more
+    static const int MAX_COMMANDS = 64; //Commands per Input message
+
+    //A player command, see InputListener::InputType
+    struct Command
+    {
+        unsigned char type;
+        unsigned char dir; //Player::WalkDirection
+    };
+};
+
+//The part of a match one client sees, quantized for the network. Positions are rounded to whole pixels in
+//16 bits. Only the soldiers and the bullets in the area of interest of the client are sent (see
+//AreaOfInterest), along with the entities destroyed there that the client does not know of yet, and the
+//team scores that changed. The client places the entities from the seed of the match and keeps what it
+//learns of them and of the scores (see NetClient), so a state only has to carry the changes.
+//A state is sent as a delta against a state the client already has: a soldier that did not change since
+//then costs a byte, and so does one that entered or left the area. Bullets are short-lived and move every
+//tick, so they are always sent in full.
+class NetState
+{
+public:
+    struct Soldier
+    {
+        uint16_t x;
+        uint16_t y;
+        uint8_t state; //Player::getState()
+    };
+
+    struct Bullet
+    {
+        uint16_t x;
+        uint16_t y;
+        uint8_t dir; //BulletPool::TravelDirection
+    };
+
+    struct Score
+    {
+        int team;
+        int score; //Simulation::getTeamScore()
+    };
+
+    int tick; //Simulation::getTick(), -1 if the state is empty
+    int numPlayers; //Size of the match
+    int numEntities;
+    int numTeams;
+    std::vector<int> players; //Soldiers in the area of interest, sorted
+    std::vector<Soldier> soldiers; //State of those soldiers, in the same order
+    std::vector<Bullet> bullets; //Bullets in the area of interest
+    std::vector<int> destroyed; //Entities in the area that are destroyed and not known to the client, sorted
+    std::vector<Score> scores; //Teams whose score changed since the base, every team in a full state
+
+    NetState();
+
+    //Copies and quantizes the given soldier
+    void addSoldier(Simulation *sim, int player);
+
+    //Copies and quantizes the given bullet
+    void addBullet(Simulation *sim, int bullet);
+
+    //Appends the state to a message, as a delta against base. Pass null to send it in full. At most maxSize
+    //bytes are appended; bullets that do not fit are left out.
+    void encode(const NetState *base, std::vector<unsigned char> &buffer, size_t maxSize) const;
+
+    //Reads a state written by encode with the same base. Returns false if the data is broken or does not
+    //fit the base, in which case the state is left empty.
+    bool decode(const NetState *base, const std::vector<unsigned char> &buffer, size_t &offset);
+};
+
+#endif
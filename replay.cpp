@@ -0,0 +1,264 @@
+#include <algorithm>
+#include <fstream>
+#include "replay.h"
+
+//File layout: magic, version, settings, keyframe interval, length, commands, keyframes.
+//Commands are stored as (tick delta, type and direction, player), with the numbers in variable length
+//encoding, so a command usually takes 3 bytes.
+static const char REPLAY_MAGIC[4] = {'B','F','3','R'};
+static const unsigned char REPLAY_VERSION = 2;
+
+bool ReplaySettings::isValid() const
+{
+    //The battlefield needs a cell to place things on, and positions are sent over the network in 16 bits
+    const int MAX_SIDE = 65535;
+    const int MAX_PLAYERS = 1 << 16;
+    const int MAX_BULLETS = 1 << 20;
+    const int MAX_TICK_RATE = 1000;
+    //teams 0 means every player is a team of its own
+    return speed >= 0 && speed <= 1000 && width >= CELL_WIDTH && width <= MAX_SIDE
+        && height >= CELL_HEIGHT && height <= MAX_SIDE
+        && barrels >= 0 && sandbags >= 0 && players >= 1 && players <= MAX_PLAYERS && teams >= 0 && teams <= players
+        && maxBullets >= 1 && maxBullets <= MAX_BULLETS && tickRate >= 1 && tickRate <= MAX_TICK_RATE;
+}
+
+Replay::Replay()
+{
+    settings = ReplaySettings();
+    keyframeInterval = DEFAULT_KEYFRAME_INTERVAL;
+    endTick = 0;
+    next = 0;
+    recorded = nullptr;
+}
+
+void Replay::startRecording(Simulation *sim, int keyframeInterval)
+{
+    stopRecording();
+    settings.speed = sim->getSpeed();
+    settings.width = sim->getWidth();
+    settings.height = sim->getHeight();
+    settings.barrels = sim->getNumBarrels();
+    settings.sandbags = sim->getNumSandbags();
+    settings.players = sim->getNumPlayers();
+    settings.teams = sim->getNumTeams();
+    settings.maxBullets = sim->getBullets()->getCapacity();
+    settings.tickRate = sim->getTickRate();
+    settings.precise = sim->getPreciseCollision();
+    settings.seed = sim->getSeed();
+    this->keyframeInterval = std::max(1, keyframeInterval);
+    endTick = sim->getTick();
+    inputs.clear();
+    keyframes.clear();
+
+    keyframes.push_back(Keyframe());
+    keyframes.back().tick = endTick;
+    sim->saveState(keyframes.back().state);
+    recorded = sim;
+    sim->setInputListener(this);
+}
+
+void Replay::stopRecording()
+{
+    if(recorded)
+        recorded->setInputListener(nullptr);
+    recorded = nullptr;
+}
+
+void Replay::onInput(int tick, int player, InputType type, Player::WalkDirection dir)
+{
+    Input input;
+    input.tick = tick;
+    input.player = player;
+    input.type = type;
+    input.dir = dir;
+    inputs.push_back(input);
+}
+
+void Replay::onTick(Simulation *sim)
+{
+    endTick = sim->getTick();
+    if((endTick - keyframes.front().tick) % keyframeInterval == 0)
+    {
+        keyframes.push_back(Keyframe());
+        keyframes.back().tick = endTick;
+        sim->saveState(keyframes.back().state);
+    }
+}
+
+bool Replay::save(const std::string &path)
+{
+    std::vector<unsigned char> buffer;
+    buffer.insert(buffer.end(), REPLAY_MAGIC, REPLAY_MAGIC + 4);
+    buffer.push_back(REPLAY_VERSION);
+    writeState(buffer,settings);
+    writeState(buffer,keyframeInterval);
+    writeState(buffer,endTick);
+
+    writeVarint(buffer,inputs.size());
+    int tick = keyframes.empty() ? 0 : keyframes.front().tick;
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        writeVarint(buffer,inputs[i].tick - tick);
+        writeVarint(buffer,inputs[i].type*(Player::None + 1) + inputs[i].dir);
+        writeVarint(buffer,inputs[i].player);
+        tick = inputs[i].tick;
+    }
+
+    writeVarint(buffer,keyframes.size());
+    for (size_t i = 0; i < keyframes.size(); i++)
+    {
+        writeVarint(buffer,keyframes[i].tick);
+        writeVarint(buffer,keyframes[i].state.size());
+        buffer.insert(buffer.end(), keyframes[i].state.begin(), keyframes[i].state.end());
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+    return file.good();
+}
+
+bool Replay::load(const std::string &path)
+{
+    stopRecording();
+    inputs.clear();
+    keyframes.clear();
+    endTick = 0;
+    next = 0;
+
+    std::ifstream file(path, std::ios::binary);
+    std::vector<unsigned char> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if(buffer.size() < 5 || !std::equal(REPLAY_MAGIC, REPLAY_MAGIC + 4, buffer.begin()) || buffer[4] != REPLAY_VERSION)
+        return false;
+
+    size_t offset = 5;
+    uint32_t count = 0;
+    bool ok = readState(buffer,offset,settings) && settings.isValid() && readState(buffer,offset,keyframeInterval)
+        && readState(buffer,offset,endTick) && readVarint(buffer,offset,count);
+    //Every command takes at least 3 bytes, so a corrupt count can not make us allocate a lot
+    ok = ok && count <= buffer.size();
+    uint32_t tick = 0;
+    for (uint32_t i = 0; ok && i < count; i++)
+    {
+        uint32_t delta, code, player;
+        ok = readVarint(buffer,offset,delta) && readVarint(buffer,offset,code) && readVarint(buffer,offset,player)
+            && code < 3*(Player::None + 1) && (int)player < settings.players;
+        if(!ok)
+            break;
+        tick += delta;
+        Input input;
+        input.tick = tick;
+        input.player = player;
+        input.type = code / (Player::None + 1);
+        input.dir = code % (Player::None + 1);
+        inputs.push_back(input);
+    }
+
+    ok = ok && readVarint(buffer,offset,count) && count <= buffer.size();
+    for (uint32_t i = 0; ok && i < count; i++)
+    {
+        uint32_t keyTick, size;
+        ok = readVarint(buffer,offset,keyTick) && readVarint(buffer,offset,size) && offset + size <= buffer.size();
+        if(!ok)
+            break;
+        keyframes.push_back(Keyframe());
+        keyframes.back().tick = keyTick;
+        keyframes.back().state.assign(buffer.begin() + offset, buffer.begin() + offset + size);
+        offset += size;
+    }
+    //The first command comes after the first keyframe
+    if(ok && !keyframes.empty() && !inputs.empty())
+    {
+        for (size_t i = 0; i < inputs.size(); i++)
+            inputs[i].tick += keyframes.front().tick;
+    }
+
+    if(!ok || keyframes.empty())
+    {
+        inputs.clear();
+        keyframes.clear();
+        endTick = 0;
+        return false;
+    }
+    return true;
+}
+
+const ReplaySettings& Replay::getSettings()
+{
+    return settings;
+}
+
+int Replay::getLength()
+{
+    return keyframes.empty() ? 0 : endTick - keyframes.front().tick;
+}
+
+bool Replay::isFinished(Simulation *sim)
+{
+    return sim->getTick() >= endTick;
+}
+
+Simulation* Replay::createSimulation(const HitboxTable &hitboxes)
+{
+    Simulation *sim = new Simulation(settings.speed,settings.width,settings.height,settings.barrels,
+                                     settings.sandbags,settings.players,settings.maxBullets,settings.tickRate);
+    sim->setHitboxes(hitboxes);
+    sim->setPreciseCollision(settings.precise);
+    sim->setSeed(settings.seed);
+    sim->setTeams(settings.teams);
+    sim->initWarzone();
+    if(!keyframes.empty())
+        seek(sim,keyframes.front().tick);
+    return sim;
+}
+
+bool Replay::seek(Simulation *sim, int tick)
+{
+    if(keyframes.empty())
+        return false;
+    tick = std::min(std::max(tick, keyframes.front().tick), endTick);
+    //Last keyframe at or before the tick
+    auto key = std::upper_bound(keyframes.begin(), keyframes.end(), tick,
+                                [](int t, const Keyframe &k) { return t < k.tick; }) - 1;
+    if(!sim->loadState(key->state))
+        return false;
+    next = std::lower_bound(inputs.begin(), inputs.end(), sim->getTick(),
+                            [](const Input &in, int t) { return in.tick < t; }) - inputs.begin();
+    while(sim->getTick() < tick)
+    {
+        applyInputs(sim);
+        sim->tick();
+    }
+    return true;
+}
+
+void Replay::applyInputs(Simulation *sim)
+{
+    int tick = sim->getTick();
+    while(next < inputs.size() && inputs[next].tick < tick) //Skip the commands of ticks we jumped over
+        next++;
+    while(next < inputs.size() && inputs[next].tick == tick)
+    {
+        const Input &input = inputs[next++];
+        Player::WalkDirection dir = (Player::WalkDirection)input.dir;
+        if(input.type == Press)
+            sim->setPressed(input.player,dir);
+        else if(input.type == Release)
+            sim->clearPressed(input.player,dir);
+        else
+            sim->shoot(input.player);
+    }
+}
+
+uint64_t Replay::hashState(Simulation *sim)
+{
+    //64 bit FNV-1a
+    std::vector<unsigned char> state;
+    sim->saveState(state);
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < state.size(); i++)
+    {
+        hash ^= state[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
@@ -0,0 +1,109 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "simulation.h"
+
+//Settings a match was started with. A replay is played back on a simulation with the same settings.
+struct ReplaySettings
+{
+    float speed;
+    int width;
+    int height;
+    int barrels;
+    int sandbags;
+    int players;
+    int teams;
+    int maxBullets;
+    int tickRate;
+    bool precise;
+    unsigned int seed; //Seed of the random number generator of the match
+
+    //Returns true if a simulation can be created with these settings. Settings read from a file or from
+    //the network must be checked before they are used.
+    bool isValid() const;
+};
+
+//Recording of a match: the player commands of every tick, and a full state keyframe every few ticks.
+//The simulation is deterministic, so applying the same commands at the same ticks reproduces the match
+//exactly. The keyframes allow seeking without simulating the match from the start.
+//
+//Recording: call startRecording() after initWarzone(); the simulation then reports every command and tick.
+//Playback: seek() to a tick, then call applyInputs() before every tick of the simulation.
+class Replay: public InputListener
+{
+public:
+    //A player command, taking effect in the given tick
+    struct Input
+    {
+        int tick;
+        int player;
+        unsigned char type; //One of the InputListener::InputType values
+        unsigned char dir; //One of the Player::WalkDirection values
+    };
+
+    //Complete state of the match at the start of a tick, before the commands of the tick
+    struct Keyframe
+    {
+        int tick;
+        std::vector<unsigned char> state; //Written by Simulation::saveState
+    };
+
+    static const int DEFAULT_KEYFRAME_INTERVAL = 100; //Ticks between two keyframes
+
+private:
+    ReplaySettings settings;
+    int keyframeInterval; //Ticks between two keyframes
+    int endTick; //Tick the recording ended at
+    std::vector<Input> inputs; //Commands, sorted by tick
+    std::vector<Keyframe> keyframes; //Keyframes, sorted by tick
+    size_t next; //Index of the next command to apply during playback
+    Simulation *recorded; //Simulation being recorded, null if not recording
+
+public:
+    Replay();
+
+    //Starts recording the given simulation. Any earlier recording is discarded.
+    //Call after initWarzone(), before the first tick.
+    void startRecording(Simulation *sim, int keyframeInterval = DEFAULT_KEYFRAME_INTERVAL);
+
+    //Stops recording. The replay keeps the ticks recorded so far.
+    void stopRecording();
+
+    //Inherited functions, called by the recorded simulation
+    void onInput(int tick, int player, InputType type, Player::WalkDirection dir);
+    void onTick(Simulation *sim);
+
+    //Writes the replay to a file. Returns false on failure.
+    bool save(const std::string &path);
+
+    //Reads a replay written by save(). Returns false on failure, in which case the replay is empty.
+    bool load(const std::string &path);
+
+    const ReplaySettings& getSettings();
+
+    //Returns the number of recorded ticks
+    int getLength();
+
+    //Returns true if a simulation is at the end of the recording
+    bool isFinished(Simulation *sim);
+
+    //Creates a simulation with the settings of the replay and moves it to the first tick. The hitboxes
+    //must be the ones used when recording.
+    Simulation* createSimulation(const HitboxTable &hitboxes = HitboxTable());
+
+    //Moves the simulation to the given tick: restores the closest keyframe before it, then simulates the
+    //remaining ticks. The simulation must have the settings of the replay. Returns false if it does not.
+    bool seek(Simulation *sim, int tick);
+
+    //Applies the commands recorded for the current tick of the simulation. Call before every tick.
+    void applyInputs(Simulation *sim);
+
+    //Returns a hash of the complete state of the simulation. Two runs that end with the same hash ended in
+    //the same state.
+    static uint64_t hashState(Simulation *sim);
+};
+
+#endif
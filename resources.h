@@ -0,0 +1,17 @@
+#ifndef RESOURCES_H
+#define RESOURCES_H
+
+#include <SFML/Graphics.hpp>
+#include "simulation.h"
+#include "atlas.h"
+
+//All the resources used by the front end, see loadResources(). This lives as long as the program, so
+//restarting a match does not load the files again.
+struct Resources
+{
+    TextureAtlas atlas; //All the images of the textures directory
+    sf::Font font; //font.ttf
+    HitboxTable hitboxes; //Generated from the images of the objects
+};
+
+#endif
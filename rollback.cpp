@@ -0,0 +1,359 @@
+#include <algorithm>
+#include "rollback.h"
+
+const uint32_t RollbackSession::VERSION;
+
+bool RollbackSession::isDuel(const ReplaySettings &settings)
+{
+    //Precise collisions need the alpha masks of the images, which a headless peer does not have. The
+    //peers would then resolve hits differently and drift apart without noticing.
+    return settings.isValid() && settings.players == 2 && !settings.precise;
+}
+
+RollbackSession::RollbackSession()
+{
+    localPlayer = -1;
+    settings = ReplaySettings();
+    sim = nullptr;
+    remoteTicks = 0;
+    peerTicks = 0;
+    rollbackTick = -1;
+    latencyMs = 0;
+    jitterMs = 0;
+    lossPercent = 0;
+    rollbacks = 0;
+    resimulated = 0;
+    maxDepth = 0;
+    lastRollbackMicros = 0;
+    maxRollbackMicros = 0;
+    stalls = 0;
+}
+
+void RollbackSession::transmit(const std::vector<unsigned char> &data)
+{
+    if(latencyMs == 0 && jitterMs == 0 && lossPercent == 0)
+    {
+        socket.send(peer, data.data(), data.size());
+        return;
+    }
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::uniform_int_distribution<int> jitter(0, jitterMs);
+    if(percent(linkGen) < lossPercent)
+        return;
+    int delay = latencyMs + jitter(linkGen);
+    delayed.push_back({std::chrono::steady_clock::now() + std::chrono::milliseconds(delay), data});
+}
+
+void RollbackSession::flush()
+{
+    auto now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < delayed.size();)
+    {
+        if(delayed[i].due > now)
+        {
+            i++;
+            continue;
+        }
+        socket.send(peer, delayed[i].data.data(), delayed[i].data.size());
+        delayed[i] = std::move(delayed.back());
+        delayed.pop_back();
+    }
+}
+
+void RollbackSession::sendSync(bool heard)
+{
+    packet.clear();
+    writeState(packet, (unsigned char)Sync);
+    writeState(packet, VERSION);
+    writeState(packet, localPlayer);
+    writeState(packet, (unsigned char)heard);
+    writeState(packet, settings);
+    transmit(packet);
+}
+
+bool RollbackSession::connect(const std::string &host, int port, int localPort, int player, const ReplaySettings &settings,
+                              int timeoutMs)
+{
+    if(player < 0 || player > 1 || !isDuel(settings) || !socket.bind(localPort) || !NetAddress::resolve(host, port, peer))
+        return false;
+    localPlayer = player;
+    this->settings = settings;
+    linkGen.seed(player);
+    bool heard = false; //A Sync of the other peer arrived
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while(std::chrono::steady_clock::now() < deadline)
+    {
+        //Send a Sync every 100 ms, in case one gets lost or the other peer is not up yet
+        sendSync(heard);
+        auto retry = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+        while(std::chrono::steady_clock::now() < retry)
+        {
+            flush();
+            if(!socket.wait(5))
+                continue;
+            NetAddress from;
+            packet.resize(Protocol::MAX_PACKET);
+            int size = socket.receive(from, packet.data(), packet.size());
+            if(size <= 0 || !(from == peer))
+                continue;
+            packet.resize(size);
+            //The first Inputs of the other peer mean that it has our Sync. Its commands are sent again.
+            if(packet[0] == Inputs && heard)
+                return true;
+            size_t offset = 1;
+            uint32_t version;
+            int other;
+            unsigned char answered;
+            ReplaySettings theirs;
+            if(packet[0] != Sync || !readState(packet, offset, version) || version != VERSION || !readState(packet, offset, other)
+               || !readState(packet, offset, answered) || !readState(packet, offset, theirs))
+                continue;
+            //Both peers need to play different players of the same two player match
+            if(other == localPlayer || !isDuel(theirs))
+                return false;
+            if(localPlayer == 1)
+                this->settings = theirs;
+            if(!heard)
+            {
+                heard = true;
+                sendSync(heard);
+            }
+            if(answered)
+            {
+                flush();
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+const ReplaySettings& RollbackSession::getSettings()
+{
+    return settings;
+}
+
+int RollbackSession::getPlayer()
+{
+    return localPlayer;
+}
+
+void RollbackSession::setSimulatedLink(int latencyMs, int jitterMs, int lossPercent)
+{
+    this->latencyMs = std::max(0, latencyMs);
+    this->jitterMs = std::max(0, jitterMs);
+    this->lossPercent = std::max(0, std::min(lossPercent, 100));
+}
+
+void RollbackSession::start(Simulation *sim)
+{
+    this->sim = sim;
+    sim->setInputListener(nullptr);
+}
+
+void RollbackSession::addCommand(InputListener::InputType type, Player::WalkDirection dir)
+{
+    if((int)pending.size() < Protocol::MAX_COMMANDS)
+        pending.push_back({(unsigned char)type, (unsigned char)dir});
+}
+
+void RollbackSession::applyCommands(int tick)
+{
+    for (int player = 0; player < 2; player++)
+    {
+        if(player != localPlayer && tick >= remoteTicks)
+            continue; //Predicted: no commands
+        for (const Protocol::Command &command : commands[player][tick % HISTORY])
+        {
+            Player::WalkDirection dir = (Player::WalkDirection)command.dir;
+            if(command.type == InputListener::Press)
+                sim->setPressed(player, dir);
+            else if(command.type == InputListener::Release)
+                sim->clearPressed(player, dir);
+            else
+                sim->shoot(player);
+        }
+    }
+}
+
+bool RollbackSession::advance()
+{
+    int tick = sim->getTick();
+    if(sim->getWinner() != -1)
+    {
+        sendInputs();
+        return false;
+    }
+    //Wait if a rollback could reach further back than the states we keep, or the other peer misses
+    //more of our commands than we keep
+    if(tick - remoteTicks >= MAX_ROLLBACK || tick - peerTicks >= HISTORY - 1)
+    {
+        stalls++;
+        sendInputs();
+        return false;
+    }
+    commands[localPlayer][tick % HISTORY].swap(pending);
+    pending.clear();
+    sim->saveRollbackState(states[tick % HISTORY]);
+    applyCommands(tick);
+    sim->tick();
+    sendInputs();
+    return true;
+}
+
+void RollbackSession::sendInputs()
+{
+    int first = peerTicks;
+    int count = std::max(0, sim->getTick() - first);
+    packet.clear();
+    writeState(packet, (unsigned char)Inputs);
+    writeState(packet, first);
+    writeState(packet, count);
+    writeState(packet, remoteTicks);
+    for (int tick = first; tick < first + count; tick++)
+    {
+        const std::vector<Protocol::Command> &list = commands[localPlayer][tick % HISTORY];
+        writeVarint(packet, list.size());
+        writeState(packet, list.data(), list.size());
+    }
+    transmit(packet);
+}
+
+void RollbackSession::readInputs(size_t offset)
+{
+    int first, count, acked;
+    if(!readState(packet, offset, first) || !readState(packet, offset, count) || !readState(packet, offset, acked))
+        return;
+    if(first < 0 || count < 0 || count > HISTORY || first > remoteTicks)
+        return;
+    //The other peer can not have more of our ticks than we simulated
+    if(acked > peerTicks)
+        peerTicks = std::min(acked, sim->getTick());
+    int remotePlayer = 1 - localPlayer;
+    std::vector<Protocol::Command> list;
+    for (int tick = first; tick < first + count; tick++)
+    {
+        uint32_t n;
+        if(!readVarint(packet, offset, n) || n > (uint32_t)Protocol::MAX_COMMANDS)
+            return;
+        list.resize(n);
+        if(!readState(packet, offset, list.data(), n))
+            return;
+        for (const Protocol::Command &command : list)
+        {
+            if(command.type > InputListener::Shoot || command.dir > Player::None)
+                return;
+        }
+        if(tick < remoteTicks)
+            continue; //Already have it
+        //Keep the commands of the ticks we may still simulate, or roll back to
+        if(tick - sim->getTick() >= HISTORY - MAX_ROLLBACK)
+            return;
+        commands[remotePlayer][tick % HISTORY] = list;
+        remoteTicks = tick + 1;
+        //No commands is what was predicted. A tick we have not simulated yet gets them when it is simulated.
+        if(!list.empty() && tick < sim->getTick() && (rollbackTick == -1 || tick < rollbackTick))
+            rollbackTick = tick;
+    }
+}
+
+void RollbackSession::rollback()
+{
+    auto start = std::chrono::steady_clock::now();
+    int from = rollbackTick, to = sim->getTick();
+    rollbackTick = -1;
+    sim->loadRollbackState(states[from % HISTORY]);
+    //The match may now end earlier than predicted; the other peer stops at the same tick
+    int tick = from;
+    for (; tick < to && sim->getWinner() == -1; tick++)
+    {
+        if(tick > from)
+            sim->saveRollbackState(states[tick % HISTORY]);
+        applyCommands(tick);
+        sim->tick();
+    }
+    rollbacks++;
+    resimulated += tick - from;
+    maxDepth = std::max(maxDepth, to - from);
+    lastRollbackMicros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    maxRollbackMicros = std::max(maxRollbackMicros, lastRollbackMicros);
+}
+
+bool RollbackSession::receive(int timeoutMs)
+{
+    flush();
+    //With datagrams held back, wake up in time to send them
+    if(!delayed.empty())
+        timeoutMs = std::min(timeoutMs, 1);
+    if(!socket.wait(timeoutMs))
+    {
+        flush();
+        return false;
+    }
+    NetAddress from;
+    while(1)
+    {
+        packet.resize(Protocol::MAX_PACKET);
+        int size = socket.receive(from, packet.data(), packet.size());
+        if(size < 0)
+            break;
+        packet.resize(size);
+        if(size > 0 && from == peer && packet[0] == Inputs)
+            readInputs(1);
+    }
+    flush();
+    if(rollbackTick == -1)
+        return false;
+    rollback();
+    return true;
+}
+
+bool RollbackSession::isConfirmed()
+{
+    return remoteTicks >= sim->getTick();
+}
+
+bool RollbackSession::isDelivered()
+{
+    return peerTicks >= sim->getTick();
+}
+
+long RollbackSession::getRollbacks()
+{
+    return rollbacks;
+}
+
+long RollbackSession::getResimulatedTicks()
+{
+    return resimulated;
+}
+
+int RollbackSession::getMaxDepth()
+{
+    return maxDepth;
+}
+
+int RollbackSession::getLastRollbackMicros()
+{
+    return lastRollbackMicros;
+}
+
+int RollbackSession::getMaxRollbackMicros()
+{
+    return maxRollbackMicros;
+}
+
+long RollbackSession::getStalls()
+{
+    return stalls;
+}
+
+uint64_t RollbackSession::getBytesReceived()
+{
+    return socket.getBytesReceived();
+}
+
+uint64_t RollbackSession::getBytesSent()
+{
+    return socket.getBytesSent();
+}
@@ -0,0 +1,160 @@
+#ifndef ROLLBACK_H
+#define ROLLBACK_H
+
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdint>
+#include "net.h"
+#include "protocol.h"
+
+//Peer to peer duel with rollback. Both peers simulate the whole match. The commands of the local player
+//are applied at the next tick without waiting for the other peer, and the other player is predicted to give
+//no commands, i.e. to keep walking the way they walk. When the commands of the other player arrive and are
+//not empty, the simulation is rolled back to the start of their tick and simulated again up to the current
+//tick. For that, the state at the start of each recent tick is kept (see Simulation::saveRollbackState).
+//The simulation runs at most MAX_ROLLBACK ticks ahead of the commands of the other peer; the peer that is
+//ahead waits for the other one. The commands of a tick are applied in player order on both peers, so both
+//simulate exactly the same match.
+//
+//Messages between the peers. Every datagram starts with a MessageType byte; values are written with
+//writeState, so both peers must have the same byte order.
+//Sync:   version, player, whether the Sync of the other peer arrived, ReplaySettings (player 0's are used)
+//Inputs: first tick, number of ticks, number of ticks we have the commands of the other peer for, then per
+//        tick the number of commands and the commands
+class RollbackSession
+{
+public:
+    enum MessageType {Sync,Inputs};
+
+    static const uint32_t VERSION = 1;
+    static const int MAX_ROLLBACK = 10; //Ticks the simulation may run ahead of the commands of the other peer
+    //Ticks of commands and states kept. The commands of the local player are kept until the other peer has
+    //them, which may be up to 2*MAX_ROLLBACK ticks back.
+    static const int HISTORY = 2*MAX_ROLLBACK + 2;
+
+private:
+    //A datagram held back by the simulated link
+    struct Delayed
+    {
+        std::chrono::steady_clock::time_point due; //Time to send it at
+        std::vector<unsigned char> data;
+    };
+
+    UdpSocket socket;
+    NetAddress peer;
+    int localPlayer; //0 or 1, the other peer plays the other one
+    ReplaySettings settings;
+    Simulation *sim;
+    std::vector<unsigned char> states[HISTORY]; //State at the start of each tick, by tick % HISTORY
+    std::vector<Protocol::Command> commands[2][HISTORY]; //Commands of each player, by tick % HISTORY
+    std::vector<Protocol::Command> pending; //Local commands for the next tick
+    int remoteTicks; //Number of ticks we have the commands of the other player for
+    int peerTicks; //Number of ticks the other peer has our commands for
+    int rollbackTick; //Earliest tick that was mispredicted, -1 if none
+    std::vector<unsigned char> packet; //Scratch buffer
+
+    //Simulated link, for testing over the loopback device
+    int latencyMs;
+    int jitterMs;
+    int lossPercent;
+    std::mt19937 linkGen;
+    std::vector<Delayed> delayed; //Datagrams held back, in no particular order
+
+    long rollbacks; //Number of rollbacks
+    long resimulated; //Number of ticks simulated again
+    int maxDepth; //Most ticks rolled back at once
+    int lastRollbackMicros; //Duration of the newest rollback
+    int maxRollbackMicros; //Longest rollback
+    long stalls; //Number of times advance() waited for the other peer
+
+    //Sends a datagram to the other peer, through the simulated link if one is set
+    void transmit(const std::vector<unsigned char> &data);
+
+    //Sends the datagrams of the simulated link that are due
+    void flush();
+
+    void sendSync(bool heard);
+
+    //Returns true if a duel can be played with the settings: two players and box collisions
+    static bool isDuel(const ReplaySettings &settings);
+
+    //Handles an Inputs message. Marks a rollback if the commands differ from the prediction.
+    void readInputs(size_t offset);
+
+    //Applies the commands of a tick in player order. The commands of the other player are only known up to
+    //remoteTicks; after that they are predicted to be empty.
+    void applyCommands(int tick);
+
+    //Restores the state at the start of rollbackTick and simulates again up to the current tick
+    void rollback();
+
+public:
+    RollbackSession();
+
+    /*
+    @brief
+        Finds the other peer. Both peers keep sending Sync messages until each has heard from the other.
+        Returns false if the other peer does not answer in time, plays the same player, or the settings are
+        not those of a two player match with box collisions (see ReplaySettings::isValid).
+    @params
+        host, port: Address of the other peer
+        localPort: Port to listen on
+        player: The player we play, 0 or 1
+        settings: Settings of the match. The settings of player 0 are used by both peers; see getSettings().
+        timeoutMs: Time to wait for the other peer
+    */
+    bool connect(const std::string &host, int port, int localPort, int player, const ReplaySettings &settings, int timeoutMs);
+
+    //Returns the settings of the match, those of player 0
+    const ReplaySettings& getSettings();
+
+    //Returns the player we play
+    int getPlayer();
+
+    //Holds back every datagram we send for latencyMs plus up to jitterMs, and drops lossPercent of them, to
+    //test over the loopback device as if the peers were far apart. Both peers should use the same values.
+    void setSimulatedLink(int latencyMs, int jitterMs, int lossPercent);
+
+    //Starts the match on the simulation, which must have been created with getSettings() and set up with
+    //initWarzone(). Its input listener is not used, since a rollback applies the commands again.
+    void start(Simulation *sim);
+
+    //Queues a command of the local player for the next tick, see InputListener::InputType
+    void addCommand(InputListener::InputType type, Player::WalkDirection dir);
+
+    //Applies the queued commands and simulates one tick. Returns false, without simulating, if the
+    //simulation is MAX_ROLLBACK ticks ahead of the other peer or the match is over. Our commands are sent
+    //to the other peer either way.
+    bool advance();
+
+    //Sends our commands the other peer does not have yet and tells it how many of its ticks we have. Call
+    //it now and then while not calling advance(), so the other peer can finish the match.
+    void sendInputs();
+
+    //Waits up to timeoutMs for messages and handles all that arrived, rolling back if a prediction was
+    //wrong. Returns true if the simulation rolled back.
+    bool receive(int timeoutMs);
+
+    //Returns true if we have the commands of the other player for every simulated tick, so the state of
+    //the simulation is final
+    bool isConfirmed();
+
+    //Returns true if the other peer has our commands for every simulated tick
+    bool isDelivered();
+
+    //Statistics of the rollbacks
+    long getRollbacks();
+    long getResimulatedTicks();
+    int getMaxDepth();
+    int getLastRollbackMicros();
+    int getMaxRollbackMicros();
+    long getStalls();
+
+    //Traffic, for bandwidth measurements
+    uint64_t getBytesReceived();
+    uint64_t getBytesSent();
+};
+
+#endif
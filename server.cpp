@@ -0,0 +1,577 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include "simulation.h"
+#include "replay.h"
+#include "bots.h"
+#include "net.h"
+#include "protocol.h"
+#include "interest.h"
+#include "framestats.h"
+
+//Authoritative game server. Simulates a match without a window and replicates it to the clients over UDP,
+//see protocol.h. Players without a client are played by bots (or stand still with --bots 0).
+//Connect with `./game --connect HOST` or `./game_headless --connect HOST`.
+//Every client is only sent what is near its soldier (see AreaOfInterest), so the traffic and the work per
+//client grow with the crowd around the soldier rather than with the size of the match.
+
+struct Options
+{
+    int port = Protocol::DEFAULT_PORT;
+    unsigned int seed = 0; //0 picks one from the clock
+    float speed = 10;
+    int width = 1024;
+    int height = 768;
+    int barrels = 15;
+    int sandbags = 15;
+    int players = 2;
+    int teams = 0; //Number of teams, 0 means every player is a team of its own
+    bool bots = true; //Let bots play the players without a client
+    int threads = 0; //Threads for the bots and the simulation, 0 means one per core
+    int maxBullets = 1024;
+    int tickRate = 30; //Ticks per second
+    long ticks = 0; //Stop after this many ticks, 0 to play until someone wins
+    int linger = 3; //Seconds to keep sending the final state after the match
+    int view = 0; //Range of the area of interest of a client in pixels, 0 for the whole battlefield
+};
+
+static void printUsage()
+{
+    std::cout << "Usage: game_server [--port N] [--seed N] [--speed N] [--width N] [--height N] [--barrels N]\n"
+                 "                   [--sandbags N] [--players N] [--teams N] [--bots 0|1] [--threads N]\n"
+                 "                   [--max-bullets N] [--tick-rate N] [--ticks N] [--view PIXELS]\n";
+}
+
+static bool parseOptions(int argc, char **argv, Options &opt)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if(i + 1 >= argc)
+            return false;
+        const char *name = argv[i];
+        const char *value = argv[++i];
+        if(!strcmp(name,"--port"))
+            opt.port = atoi(value);
+        else if(!strcmp(name,"--seed"))
+            opt.seed = strtoul(value,nullptr,10);
+        else if(!strcmp(name,"--speed"))
+            opt.speed = atof(value);
+        else if(!strcmp(name,"--width"))
+            opt.width = atoi(value);
+        else if(!strcmp(name,"--height"))
+            opt.height = atoi(value);
+        else if(!strcmp(name,"--barrels"))
+            opt.barrels = atoi(value);
+        else if(!strcmp(name,"--sandbags"))
+            opt.sandbags = atoi(value);
+        else if(!strcmp(name,"--players"))
+            opt.players = std::max(1, atoi(value));
+        else if(!strcmp(name,"--teams"))
+            opt.teams = atoi(value);
+        else if(!strcmp(name,"--bots"))
+            opt.bots = atoi(value) != 0;
+        else if(!strcmp(name,"--threads"))
+            opt.threads = atoi(value);
+        else if(!strcmp(name,"--max-bullets"))
+            opt.maxBullets = atoi(value);
+        else if(!strcmp(name,"--tick-rate"))
+            opt.tickRate = std::max(1, atoi(value));
+        else if(!strcmp(name,"--ticks"))
+            opt.ticks = atol(value);
+        else if(!strcmp(name,"--view"))
+            opt.view = std::max(0, atoi(value));
+        else
+            return false;
+    }
+    return true;
+}
+
+class Server
+{
+    static const int HISTORY = 64; //Sent states kept as delta bases, must match NetClient
+    static const int TIMEOUT = 5; //Seconds of silence after which a client is dropped
+
+    struct Client
+    {
+        NetAddress address;
+        int player;
+        int acked; //Newest tick the client received, -1 if none
+        uint32_t applied; //Number of its commands applied to the simulation
+        std::chrono::steady_clock::time_point joined;
+        std::chrono::steady_clock::time_point lastHeard;
+        uint64_t bytesSent;
+        uint64_t bytesReceived;
+        AreaOfInterest area;
+        std::vector<unsigned char> known; //Entities the client knows are destroyed
+        NetState history[HISTORY]; //States sent to the client, indexed by tick % HISTORY
+    };
+
+    Simulation *sim;
+    ReplaySettings settings;
+    UdpSocket socket;
+    std::vector<Client> clients;
+    std::vector<int> owner; //Client index of every player, -1 if it has none
+    Bots *bots;
+    HunterBot hunter;
+    int view; //See Options::view
+    InterestGrid grid;
+    //Teams whose score changed in each tick, indexed by tick % HISTORY, so a delta only carries those
+    std::vector<int> scoreLog[HISTORY];
+    std::vector<int> teamScores; //Scores at the newest logged tick
+    int loggedTick; //Newest tick in the score log
+    std::vector<unsigned char> packet; //Scratch buffer
+    std::vector<int> changedTeams; //Scratch array
+
+    //Returns the client with the address, or -1
+    int findClient(const NetAddress &address);
+
+    void handleHello(const NetAddress &from);
+    void handleInput(int client, size_t offset);
+    void dropClient(int client);
+
+    //Adds the teams whose score changed since the last call to the score log
+    void logScores();
+
+    //Fills the state of the current tick for a client, as far as it sees it. base is the newest state the
+    //client has, or null.
+    void captureView(Client &client, const NetState *base, NetState &state);
+
+public:
+    FrameStats tickTime; //Server time per tick: receiving, simulating, encoding and sending
+    long fullStates = 0;
+    long deltaStates = 0;
+
+    //The simulation must be set up with initWarzone(). view: see Options::view
+    Server(Simulation *sim, const ReplaySettings &settings, Bots *bots, int view);
+
+    bool listen(int port);
+
+    //Handles all the messages that arrived
+    void receive();
+
+    //Sends the state of the current tick to every client
+    void sendState();
+
+    //Drops the clients that have been silent too long
+    void dropSilentClients();
+
+    //Waits up to timeoutMs for a message
+    bool wait(int timeoutMs);
+
+    int getNumClients();
+
+    //Prints the traffic of every client since it joined
+    void printClients();
+
+    uint64_t getBytesSent();
+    uint64_t getBytesReceived();
+};
+
+const int Server::HISTORY;
+const int Server::TIMEOUT;
+
+Server::Server(Simulation *sim, const ReplaySettings &settings, Bots *bots, int view)
+    : grid(settings.width, settings.height)
+{
+    this->sim = sim;
+    this->settings = settings;
+    this->bots = bots;
+    this->view = view;
+    grid.setEntities(sim->getWorld());
+    teamScores.assign(sim->getNumTeams(), 0);
+    loggedTick = sim->getTick();
+    owner.assign(sim->getNumPlayers(), -1);
+    for (int i = 0; bots && i < sim->getNumPlayers(); i++)
+        bots->setController(i,&hunter);
+}
+
+bool Server::listen(int port)
+{
+    return socket.bind(port);
+}
+
+bool Server::wait(int timeoutMs)
+{
+    return socket.wait(timeoutMs);
+}
+
+int Server::findClient(const NetAddress &address)
+{
+    for (size_t i = 0; i < clients.size(); i++)
+    {
+        if(clients[i].address == address)
+            return i;
+    }
+    return -1;
+}
+
+void Server::handleHello(const NetAddress &from)
+{
+    int c = findClient(from);
+    if(c == -1)
+    {
+        int player = std::find(owner.begin(), owner.end(), -1) - owner.begin();
+        packet.clear();
+        if(player == (int)owner.size())
+        {
+            writeState(packet, (unsigned char)Protocol::Reject);
+            writeState(packet, Protocol::VERSION);
+            socket.send(from, packet.data(), packet.size());
+            return;
+        }
+        Client client;
+        client.address = from;
+        client.player = player;
+        client.acked = -1;
+        client.applied = 0;
+        client.bytesSent = 0;
+        client.bytesReceived = 0;
+        client.joined = std::chrono::steady_clock::now();
+        client.area = AreaOfInterest(view);
+        client.known.assign(sim->getWorld().getSize(), 0);
+        clients.push_back(client);
+        c = clients.size() - 1;
+        owner[player] = c;
+        //Take the soldier over from its bot with no keys held down
+        if(bots)
+            bots->setController(player,nullptr);
+        for (int dir = Player::Left; dir <= Player::Down; dir++)
+            sim->clearPressed(player,(Player::WalkDirection)dir);
+        std::cout << from.toString() << " plays player " << player + 1 << "\n";
+    }
+    //Answer every hello, the first welcome may have been lost
+    clients[c].lastHeard = std::chrono::steady_clock::now();
+    packet.clear();
+    writeState(packet, (unsigned char)Protocol::Welcome);
+    writeState(packet, Protocol::VERSION);
+    writeState(packet, clients[c].player);
+    writeState(packet, settings);
+    socket.send(from, packet.data(), packet.size());
+    clients[c].bytesSent += packet.size();
+}
+
+void Server::handleInput(int c, size_t offset)
+{
+    Client &client = clients[c];
+    int acked;
+    uint32_t first, count;
+    if(!readState(packet, offset, acked) || !readState(packet, offset, first) || !readVarint(packet, offset, count)
+       || count > Protocol::MAX_COMMANDS)
+        return;
+    Protocol::Command commands[Protocol::MAX_COMMANDS];
+    if(!readState(packet, offset, commands, count))
+        return;
+    //The client has the destroyed entities of the newest state it acknowledges
+    if(acked > client.acked && client.history[acked % HISTORY].tick == acked)
+    {
+        for (int entity : client.history[acked % HISTORY].destroyed)
+            client.known[entity] = 1;
+    }
+    client.acked = std::max(client.acked, acked);
+    //The commands before `applied` were sent before and are applied already
+    for (uint32_t i = client.applied > first ? client.applied - first : 0; i < count && first + i == client.applied; i++)
+    {
+        Player::WalkDirection dir = (Player::WalkDirection)std::min<int>(commands[i].dir, Player::Down);
+        if(commands[i].type == InputListener::Press)
+            sim->setPressed(client.player,dir);
+        else if(commands[i].type == InputListener::Release)
+            sim->clearPressed(client.player,dir);
+        else
+            sim->shoot(client.player);
+        client.applied++;
+    }
+}
+
+void Server::dropClient(int c)
+{
+    std::cout << clients[c].address.toString() << " left\n";
+    int player = clients[c].player;
+    owner[player] = -1;
+    for (int dir = Player::Left; dir <= Player::Down; dir++)
+        sim->clearPressed(player,(Player::WalkDirection)dir);
+    if(bots)
+        bots->setController(player,&hunter);
+    clients.erase(clients.begin() + c);
+    for (int &o : owner)
+    {
+        if(o > c)
+            o--;
+    }
+}
+
+void Server::receive()
+{
+    NetAddress from;
+    while(1)
+    {
+        packet.resize(Protocol::MAX_PACKET);
+        int size = socket.receive(from, packet.data(), packet.size());
+        if(size < 0)
+            break;
+        packet.resize(size);
+        if(size == 0)
+            continue;
+        uint32_t version;
+        size_t offset = 1;
+        if(packet[0] == Protocol::Hello && readState(packet, offset, version) && version == Protocol::VERSION)
+        {
+            handleHello(from);
+            continue;
+        }
+        int c = findClient(from);
+        if(c == -1)
+            continue;
+        clients[c].lastHeard = std::chrono::steady_clock::now();
+        clients[c].bytesReceived += size;
+        if(packet[0] == Protocol::Input)
+            handleInput(c, 1);
+        else if(packet[0] == Protocol::Bye)
+            dropClient(c);
+    }
+}
+
+void Server::logScores()
+{
+    int tick = sim->getTick();
+    if(tick == loggedTick)
+        return;
+    //A tick that was not logged, e.g. one skipped before the first client, counts as changing every team
+    bool all = tick - loggedTick > 1;
+    loggedTick = tick;
+    std::vector<int> &log = scoreLog[tick % HISTORY];
+    log.clear();
+    for (int team = 0; team < (int)teamScores.size(); team++)
+    {
+        int score = sim->getTeamScore(team);
+        if(all || score != teamScores[team])
+            log.push_back(team);
+        teamScores[team] = score;
+    }
+}
+
+void Server::captureView(Client &client, const NetState *base, NetState &state)
+{
+    const World &world = sim->getWorld();
+    state = NetState();
+    state.tick = sim->getTick();
+    state.numPlayers = sim->getNumPlayers();
+    state.numEntities = world.getSize();
+    state.numTeams = sim->getNumTeams();
+
+    client.area.update(grid, sim, client.player);
+    for (int player : client.area.getPlayers())
+        state.addSoldier(sim, player);
+    client.area.forEachBullet(grid, [&](int bullet)
+    {
+        state.addBullet(sim, bullet);
+    });
+    client.area.forEachEntity(grid, [&](int entity)
+    {
+        if(!world.isAlive(entity) && !client.known[entity])
+            state.destroyed.push_back(entity);
+    });
+    std::sort(state.destroyed.begin(), state.destroyed.end());
+
+    //Only the scores that changed since the base, unless the log no longer reaches back that far
+    changedTeams.clear();
+    if(base && state.tick - base->tick < HISTORY)
+    {
+        for (int tick = base->tick + 1; tick <= state.tick; tick++)
+            changedTeams.insert(changedTeams.end(), scoreLog[tick % HISTORY].begin(), scoreLog[tick % HISTORY].end());
+        std::sort(changedTeams.begin(), changedTeams.end());
+        changedTeams.erase(std::unique(changedTeams.begin(), changedTeams.end()), changedTeams.end());
+    }
+    else
+    {
+        for (int team = 0; team < state.numTeams; team++)
+            changedTeams.push_back(team);
+    }
+    for (int team : changedTeams)
+        state.scores.push_back({team, teamScores[team]});
+}
+
+void Server::sendState()
+{
+    int tick = sim->getTick();
+    logScores();
+    grid.update(sim);
+    for (Client &client : clients)
+    {
+        //Send a delta against the newest state the client has, if we still have it
+        const NetState *base = nullptr;
+        if(client.acked >= 0 && client.history[client.acked % HISTORY].tick == client.acked)
+            base = &client.history[client.acked % HISTORY];
+        NetState &state = client.history[tick % HISTORY];
+        //After the match the same tick is sent again, so the base may be the state we are about to replace
+        NetState copy;
+        if(base == &state)
+        {
+            copy = state;
+            base = &copy;
+        }
+        captureView(client, base, state);
+        packet.clear();
+        writeState(packet, (unsigned char)Protocol::Snapshot);
+        writeState(packet, state.tick);
+        writeState(packet, base ? base->tick : -1);
+        writeState(packet, client.applied);
+        state.encode(base, packet, Protocol::MAX_PACKET - packet.size());
+        socket.send(client.address, packet.data(), packet.size());
+        client.bytesSent += packet.size();
+        (base ? deltaStates : fullStates)++;
+    }
+}
+
+void Server::dropSilentClients()
+{
+    auto now = std::chrono::steady_clock::now();
+    for (int c = clients.size() - 1; c >= 0; c--)
+    {
+        if(now - clients[c].lastHeard > std::chrono::seconds(TIMEOUT))
+            dropClient(c);
+    }
+}
+
+int Server::getNumClients()
+{
+    return clients.size();
+}
+
+void Server::printClients()
+{
+    auto now = std::chrono::steady_clock::now();
+    for (const Client &client : clients)
+    {
+        double seconds = std::max(1e-3, std::chrono::duration<double>(now - client.joined).count());
+        std::cout << "  " << client.address.toString() << " player " << client.player + 1 << ": sent "
+                  << (int)(client.bytesSent / seconds) << " B/s, received " << (int)(client.bytesReceived / seconds) << " B/s\n";
+    }
+}
+
+uint64_t Server::getBytesSent()
+{
+    return socket.getBytesSent();
+}
+
+uint64_t Server::getBytesReceived()
+{
+    return socket.getBytesReceived();
+}
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    if(!parseOptions(argc,argv,opt))
+    {
+        printUsage();
+        return 1;
+    }
+    if(opt.seed == 0)
+        opt.seed = std::chrono::system_clock::now().time_since_epoch().count();
+
+    //The clients build the same battlefield from these settings
+    ReplaySettings settings;
+    settings.speed = opt.speed;
+    settings.width = opt.width;
+    settings.height = opt.height;
+    settings.barrels = opt.barrels;
+    settings.sandbags = opt.sandbags;
+    settings.players = opt.players;
+    settings.teams = opt.teams;
+    settings.maxBullets = opt.maxBullets;
+    settings.tickRate = opt.tickRate;
+    settings.precise = false;
+    settings.seed = opt.seed;
+    if(!settings.isValid())
+    {
+        std::cout << "A match can not be played with these settings\n";
+        printUsage();
+        return 1;
+    }
+
+    WorkerPool pool(opt.threads);
+    Simulation sim(opt.speed,opt.width,opt.height,opt.barrels,opt.sandbags,opt.players,opt.maxBullets,opt.tickRate);
+    sim.setSeed(opt.seed);
+    sim.setWorkerPool(&pool);
+    if(opt.teams > 0)
+        sim.setTeams(opt.teams);
+    sim.initWarzone();
+
+    settings.teams = sim.getNumTeams(); //0 turns into one team per player
+
+    Bots bots(&pool);
+    Server server(&sim,settings,opt.bots ? &bots : nullptr,opt.view);
+    if(!server.listen(opt.port))
+    {
+        std::cout << "Can not listen on port " << opt.port << "\n";
+        return 1;
+    }
+    std::cout << "listening on port " << opt.port << ", " << sim.getNumPlayers() << " players, "
+              << opt.tickRate << " ticks/s, view " << (opt.view > 0 ? std::to_string(opt.view) + " px" : "everything") << "\n";
+
+    const auto tickLength = std::chrono::nanoseconds(1000000000 / opt.tickRate);
+    auto start = std::chrono::steady_clock::now();
+    auto nextTick = start;
+    auto nextReport = start + std::chrono::seconds(5);
+    auto end = std::chrono::steady_clock::time_point::max();
+    uint64_t lastSent = 0;
+    std::clock_t cpuStart = std::clock();
+    while(std::chrono::steady_clock::now() < end)
+    {
+        //Handle the messages until the next tick is due
+        auto now = std::chrono::steady_clock::now();
+        while(now < nextTick)
+        {
+            int ms = std::chrono::duration_cast<std::chrono::milliseconds>(nextTick - now).count();
+            if(server.wait(std::max(ms, 1)))
+                server.receive();
+            now = std::chrono::steady_clock::now();
+        }
+        //Start over from now if we fell far behind, instead of running lots of ticks at once
+        nextTick = std::max(nextTick + tickLength, now - 4*tickLength);
+
+        auto tickStart = std::chrono::steady_clock::now();
+        server.receive();
+        server.dropSilentClients();
+        bool over = sim.getWinner() != -1 || (opt.ticks > 0 && sim.getTick() >= opt.ticks);
+        if(!over)
+        {
+            if(opt.bots)
+                bots.update(&sim);
+            sim.tick();
+        }
+        else if(end == std::chrono::steady_clock::time_point::max())
+            end = now + std::chrono::seconds(opt.linger);
+        server.sendState();
+        server.tickTime.add(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - tickStart).count());
+
+        if(now >= nextReport)
+        {
+            double sent = (server.getBytesSent() - lastSent) / 5.0;
+            lastSent = server.getBytesSent();
+            std::cout << "tick " << sim.getTick() << ", clients " << server.getNumClients() << ", sent " << (int)sent
+                      << " B/s, tick time p50 " << server.tickTime.getPercentile(0.5) << " us, p99 "
+                      << server.tickTime.getPercentile(0.99) << " us\n";
+            server.printClients();
+            nextReport += std::chrono::seconds(5);
+        }
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double cpu = (double)(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+    std::cout << "ticks: " << sim.getTick() << "\n"
+              << "winner: " << (sim.getWinner() == -1 ? "none" : std::to_string(sim.getWinner() + 1)) << "\n"
+              << "elapsed: " << elapsed << " s\n"
+              << "cpu: " << cpu << " s (" << 100 * cpu / std::max(elapsed, 1e-9) << "%)\n"
+              << "sent: " << server.getBytesSent() << " B (" << server.fullStates << " full states, "
+              << server.deltaStates << " deltas)\n"
+              << "received: " << server.getBytesReceived() << " B\n"
+              << "final state: " << std::hex << Replay::hashState(&sim) << std::dec << "\n";
+    return 0;
+}
@@ -0,0 +1,1705 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <type_traits>
+#include <functional>
+#include "simulation.h"
+#include "workers.h"
+#include "kernels.h"
+#include "profiler.h"
+
+//Calls body(begin,end) for chunks of [0,n) on the pool, or once for the whole range on the calling thread
+//if there is no pool or the range fits into one chunk.
+template <typename Body>
+static void forRange(WorkerPool *pool, int n, int grain, const Body &body)
+{
+    if(pool && n > grain)
+        pool->parallelFor(n,grain,body);
+    else if(n > 0)
+        body(0,n);
+}
+
+Coord::Coord()
+{
+    this->x=0;
+    this->y=0;
+}
+
+Coord::Coord(float x, float y)
+{
+    this->x=x;
+    this->y=y;
+}
+
+Rect::Rect()
+{
+    left = 0;
+    top = 0;
+    width = 0;
+    height = 0;
+}
+
+Rect::Rect(float left, float top, float width, float height)
+{
+    this->left = left;
+    this->top = top;
+    this->width = width;
+    this->height = height;
+}
+
+bool Rect::intersects(const Rect &other) const
+{
+    //Compute the intersection boundaries, then see if the intersection is empty.
+    float interLeft = std::max(left, other.left);
+    float interTop = std::max(top, other.top);
+    float interRight = std::min(left + width, other.left + other.width);
+    float interBottom = std::min(top + height, other.top + other.height);
+    return interLeft < interRight && interTop < interBottom;
+}
+
+BitMask::BitMask()
+{
+    width = 0;
+    height = 0;
+    words = 0;
+}
+
+void BitMask::create(const unsigned char *rgba, int width, int height, int radius)
+{
+    this->width = width;
+    this->height = height;
+    words = (width + 63) / 64;
+
+    //Find the solid pixels
+    std::vector<unsigned char> solid(width*height), tmp(width*height);
+    for (int i = 0; i < width*height; i++)
+        solid[i] = rgba[4*i + 3] >= ALPHA_THRESHOLD;
+
+    if(radius > 0)
+    {
+        //Opening is an erosion followed by a dilation. Both are done with a square, which can be split
+        //into a horizontal and a vertical pass. Pixels outside the image count as empty.
+        for (int pass = 0; pass < 4; pass++)
+        {
+            bool erode = pass < 2;
+            bool horizontal = pass % 2 == 0;
+            for (int y = 0; y < height; y++)
+            {
+                for (int x = 0; x < width; x++)
+                {
+                    unsigned char v = erode;
+                    for (int d = -radius; d <= radius; d++)
+                    {
+                        int sx = horizontal ? x + d : x;
+                        int sy = horizontal ? y : y + d;
+                        unsigned char p = (sx >= 0 && sx < width && sy >= 0 && sy < height) ? solid[sy*width + sx] : 0;
+                        v = erode ? (v & p) : (v | p);
+                    }
+                    tmp[y*width + x] = v;
+                }
+            }
+            solid.swap(tmp);
+        }
+    }
+
+    //Pack the rows
+    bits.assign(words*height, 0);
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            if(solid[y*width + x])
+                bits[y*words + x/64] |= (uint64_t)1 << (x%64);
+}
+
+bool BitMask::isLoaded() const
+{
+    return !bits.empty();
+}
+
+bool BitMask::getBoundingBox(int &left, int &top, int &width, int &height) const
+{
+    int x0 = this->width, y0 = this->height, x1 = -1, y1 = -1;
+    for (int y = 0; y < this->height; y++)
+    {
+        for (int k = 0; k < words; k++)
+        {
+            uint64_t w = bits[y*words + k];
+            if(w == 0)
+                continue;
+            y0 = std::min(y0, y);
+            y1 = y;
+            x0 = std::min(x0, 64*k + __builtin_ctzll(w));
+            x1 = std::max(x1, 64*k + 63 - __builtin_clzll(w));
+        }
+    }
+    if(x1 < 0)
+        return false;
+    left = x0;
+    top = y0;
+    width = x1 - x0 + 1;
+    height = y1 - y0 + 1;
+    return true;
+}
+
+bool BitMask::overlaps(const Rect &r) const
+{
+    //Pixels covered by the rectangle, clipped to the mask
+    int x0 = std::max(0, (int)std::floor(r.left));
+    int y0 = std::max(0, (int)std::floor(r.top));
+    int x1 = std::min(width, (int)std::ceil(r.left + r.width));
+    int y1 = std::min(height, (int)std::ceil(r.top + r.height));
+    if(x0 >= x1 || y0 >= y1)
+        return false;
+
+    for (int k = x0/64; k <= (x1-1)/64; k++)
+    {
+        //Bits of word k that are inside the rectangle
+        int from = std::max(x0 - 64*k, 0);
+        int to = std::min(x1 - 64*k, 64);
+        uint64_t range = (to - from == 64) ? ~(uint64_t)0 : (((uint64_t)1 << (to - from)) - 1) << from;
+        for (int y = y0; y < y1; y++)
+        {
+            if(bits[y*words + k] & range)
+                return true;
+        }
+    }
+    return false;
+}
+
+HitboxTable::HitboxTable()
+{
+    //Generated from the images in the textures folder with the same algorithm as load().
+    const Hitbox soldierBoxes[14] = {
+        {24,47,44,27}, {26,41,32,39}, {33,39,28,44}, {23,37,46,34}, {23,43,44,28}, {34,35,32,39}, {30,33,28,44},
+        {24,46,46,34}, {26,47,38,38}, {24,43,38,38}, {26,42,36,44}, {26,34,38,38}, {27,32,41,45}, {29,31,36,44}
+    };
+    for (int i = 0; i < 14; i++)
+        soldier[i] = soldierBoxes[i];
+    for (int t = 0; t < World::NUM_TYPES; t++)
+        object[t] = World::TYPES[t].hitbox;
+}
+
+void HitboxTable::load(BitMask &mask, Hitbox &box, const unsigned char *rgba, int width, int height, int radius)
+{
+    mask.create(rgba,width,height,radius);
+    int left, top, w, h;
+    if(mask.getBoundingBox(left,top,w,h))
+        box = {(unsigned char)left, (unsigned char)top, (unsigned char)w, (unsigned char)h};
+    else //Nothing can hit an invisible sprite
+        box = {0,0,0,0};
+}
+
+Rect HitboxTable::place(const Hitbox &box, Coord pos)
+{
+    return Rect(pos.x + box.left, pos.y + box.top, box.width, box.height);
+}
+
+bool HitboxTable::test(const BitMask &mask, Coord pos, const Rect &r)
+{
+    if(!mask.isLoaded())
+        return true;
+    return mask.overlaps(Rect(r.left - pos.x, r.top - pos.y, r.width, r.height));
+}
+
+void HitboxTable::setSoldier(int state, const unsigned char *rgba, int width, int height)
+{
+    load(soldierMask[state],soldier[state],rgba,width,height,SOLDIER_BODY_RADIUS);
+}
+
+void HitboxTable::setObject(World::Type type, const unsigned char *rgba, int width, int height)
+{
+    load(objectMask[type],object[type],rgba,width,height,0);
+}
+
+Rect HitboxTable::getSoldierBox(Coord pos, int state) const
+{
+    return place(soldier[state],pos);
+}
+
+Rect HitboxTable::getObjectBox(World::Type type, Coord pos) const
+{
+    return place(object[type],pos);
+}
+
+bool HitboxTable::hitsSoldier(Coord pos, int state, const Rect &r) const
+{
+    return test(soldierMask[state],pos,r);
+}
+
+bool HitboxTable::hitsObject(World::Type type, Coord pos, const Rect &r) const
+{
+    return test(objectMask[type],pos,r);
+}
+
+//The built-in hitboxes were generated from the images in the textures folder, see HitboxTable::load()
+const World::TypeInfo World::TYPES[World::NUM_TYPES] = {
+    {"textures/bags.png", {0,0,60,69}, ObstacleMap::Sandbag, 0},
+    {"textures/barrel.png", {1,0,59,59}, ObstacleMap::Barrel, 1}
+};
+
+int World::create(Type type)
+{
+    position.push_back(Coord(0,0));
+    this->type.push_back(type);
+    health.push_back(TYPES[type].health);
+    return position.size() - 1;
+}
+
+void World::spawn(int entity, Coord pos)
+{
+    position[entity] = pos;
+    health[entity] = TYPES[type[entity]].health;
+}
+
+int World::getSize() const
+{
+    return position.size();
+}
+
+Coord World::getPosition(int entity) const
+{
+    return position[entity];
+}
+
+World::Type World::getType(int entity) const
+{
+    return (Type)type[entity];
+}
+
+bool World::isAlive(int entity) const
+{
+    return TYPES[type[entity]].health == 0 || health[entity] > 0;
+}
+
+bool World::damage(int entity)
+{
+    if(TYPES[type[entity]].health == 0 || health[entity] == 0)
+        return false;
+    health[entity]--;
+    return health[entity] == 0;
+}
+
+void World::saveState(std::vector<unsigned char> &buffer)
+{
+    for (size_t i = 0; i < position.size(); i++)
+    {
+        writeState(buffer,position[i]);
+        if(TYPES[type[i]].health != 0)
+            writeState(buffer,health[i]);
+    }
+}
+
+bool World::loadState(const std::vector<unsigned char> &buffer, size_t &offset)
+{
+    for (size_t i = 0; i < position.size(); i++)
+    {
+        if(!readState(buffer,offset,position[i]))
+            return false;
+        if(TYPES[type[i]].health != 0 && !readState(buffer,offset,health[i]))
+            return false;
+    }
+    return true;
+}
+
+void World::saveHealth(std::vector<unsigned char> &buffer)
+{
+    writeState(buffer,health.data(),health.size());
+}
+
+bool World::loadHealth(const std::vector<unsigned char> &buffer, size_t &offset, std::vector<int> &changed)
+{
+    int n = health.size();
+    if(offset + n > buffer.size())
+        return false;
+    const unsigned char *saved = buffer.data() + offset;
+    for (int i = 0; i < n; i++)
+    {
+        if((health[i] > 0) != (saved[i] > 0))
+            changed.push_back(i);
+    }
+    memcpy(health.data(),saved,n);
+    offset += n;
+    return true;
+}
+
+//A soldier at (x,y) can not walk in a direction if an obstacle at (ox,oy) satisfies
+//xlo < x - ox < xhi and ylo < y - oy < yhi. You can play with the numbers to tweak the hitbox of the objects.
+struct BlockZone
+{
+    float xlo, xhi, ylo, yhi;
+};
+
+//Indexed by [WalkDirection][Tile-1]
+static const BlockZone blockZones[4][2] = {
+    {{0,40,-70,20}, {0,40,-70,15}}, //Left: sandbag, barrel
+    {{-55,30,0,35}, {-55,20,0,25}}, //Up
+    {{-80,0,-70,20}, {-70,0,-70,15}}, //Right
+    {{-55,30,-80,0}, {-55,20,-80,0}} //Down
+};
+
+ObstacleMap::ObstacleMap(int width, int height)
+{
+    cols = std::max(1, (width + CELL_WIDTH - 1) / CELL_WIDTH);
+    rows = std::max(1, (height + CELL_HEIGHT - 1) / CELL_HEIGHT);
+    tiles.assign(cols*rows, Empty);
+}
+
+void ObstacleMap::setTile(Coord pos, Tile tile)
+{
+    int coord_x = pos.x / CELL_WIDTH;
+    int coord_y = pos.y / CELL_HEIGHT;
+    tiles[coord_y*cols + coord_x] = tile;
+}
+
+bool ObstacleMap::isBlocked(Coord pos, Player::WalkDirection dir) const
+{
+    const BlockZone *zones = blockZones[dir];
+    //Only the obstacles with x - xhi < ox < x - xlo can block, likewise for y. Find the cells where such
+    //obstacles could be, using the larger zone of the two obstacle kinds.
+    float xlo = std::min(zones[0].xlo, zones[1].xlo), xhi = std::max(zones[0].xhi, zones[1].xhi);
+    float ylo = std::min(zones[0].ylo, zones[1].ylo), yhi = std::max(zones[0].yhi, zones[1].yhi);
+    int x0 = std::max((int)std::floor((pos.x - xhi) / CELL_WIDTH), 0);
+    int x1 = std::min((int)std::ceil((pos.x - xlo) / CELL_WIDTH), cols - 1);
+    int y0 = std::max((int)std::floor((pos.y - yhi) / CELL_HEIGHT), 0);
+    int y1 = std::min((int)std::ceil((pos.y - ylo) / CELL_HEIGHT), rows - 1);
+
+    for (int cy = y0; cy <= y1; cy++)
+    {
+        for (int cx = x0; cx <= x1; cx++)
+        {
+            unsigned char tile = tiles[cy*cols + cx];
+            if(tile == Empty)
+                continue;
+            const BlockZone &z = zones[tile - 1];
+            float dx = pos.x - CELL_WIDTH*cx;
+            float dy = pos.y - CELL_HEIGHT*cy;
+            if(dx > z.xlo && dx < z.xhi && dy > z.ylo && dy < z.yhi)
+                return true;
+        }
+    }
+    return false;
+}
+
+OccupancyGrid::OccupancyGrid(int width, int height)
+{
+    cols = std::max(0, width / CELL_WIDTH);
+    rows = std::max(0, height / CELL_HEIGHT);
+    int size = cols * rows;
+    bits.assign((size + 63) / 64, 0);
+    freeCells.resize(size);
+    freeIndex.resize(size);
+    for (int i = 0; i < size; i++)
+    {
+        freeCells[i] = i;
+        freeIndex[i] = i;
+    }
+}
+
+int OccupancyGrid::getSize() const
+{
+    return cols * rows;
+}
+
+int OccupancyGrid::getFreeCount() const
+{
+    return freeCells.size();
+}
+
+int OccupancyGrid::getCell(Coord pos) const
+{
+    int x = std::min(std::max((int)(pos.x / CELL_WIDTH), 0), cols - 1);
+    int y = std::min(std::max((int)(pos.y / CELL_HEIGHT), 0), rows - 1);
+    return y * cols + x;
+}
+
+Coord OccupancyGrid::getPosition(int cell) const
+{
+    return Coord(CELL_WIDTH * (cell % cols), CELL_HEIGHT * (cell / cols));
+}
+
+bool OccupancyGrid::isOccupied(int cell) const
+{
+    return (bits[cell >> 6] >> (cell & 63)) & 1;
+}
+
+void OccupancyGrid::occupy(int cell)
+{
+    if(isOccupied(cell))
+        return;
+    bits[cell >> 6] |= (uint64_t)1 << (cell & 63);
+    //Move the last free cell into the slot of this one
+    int index = freeIndex[cell];
+    int last = freeCells.back();
+    freeCells[index] = last;
+    freeIndex[last] = index;
+    freeCells.pop_back();
+    freeIndex[cell] = -1;
+}
+
+void OccupancyGrid::release(int cell)
+{
+    if(!isOccupied(cell))
+        return;
+    bits[cell >> 6] &= ~((uint64_t)1 << (cell & 63));
+    freeIndex[cell] = freeCells.size();
+    freeCells.push_back(cell);
+}
+
+int OccupancyGrid::sample(std::mt19937 &gen) const
+{
+    if(freeCells.empty())
+        return -1;
+    std::uniform_int_distribution<int> random_index(0, freeCells.size() - 1);
+    return freeCells[random_index(gen)];
+}
+
+void OccupancyGrid::saveState(std::vector<unsigned char> &buffer)
+{
+    int n = freeCells.size();
+    writeState(buffer,n);
+    writeState(buffer,freeCells.data(),n);
+}
+
+bool OccupancyGrid::loadState(const std::vector<unsigned char> &buffer, size_t &offset)
+{
+    int n;
+    if(!readState(buffer,offset,n) || n < 0 || n > getSize())
+        return false;
+    loaded.resize(n);
+    if(!readState(buffer,offset,loaded.data(),n))
+        return false;
+    for (int i = 0; i < n; i++)
+    {
+        if(loaded[i] < 0 || loaded[i] >= getSize())
+            return false;
+    }
+    //Every cell is occupied, except the saved free cells. The old list is kept as the next scratch array.
+    std::fill(bits.begin(), bits.end(), ~(uint64_t)0);
+    std::fill(freeIndex.begin(), freeIndex.end(), -1);
+    freeCells.swap(loaded);
+    for (int i = 0; i < n; i++)
+    {
+        bits[freeCells[i] >> 6] &= ~((uint64_t)1 << (freeCells[i] & 63));
+        freeIndex[freeCells[i]] = i;
+    }
+    return true;
+}
+
+CollisionGrid::CollisionGrid(int width, int height, const HitboxTable *hitboxes)
+{
+    this->hitboxes = hitboxes;
+    precise = false;
+    cols = std::max(1, (width + CELL_WIDTH - 1) / CELL_WIDTH);
+    rows = std::max(1, (height + CELL_HEIGHT - 1) / CELL_HEIGHT);
+    obstacleStart.assign(cols*rows + 1, 0);
+    playerStart.assign(cols*rows + 1, 0);
+}
+
+void CollisionGrid::setPrecise(bool precise)
+{
+    this->precise = precise;
+}
+
+bool CollisionGrid::isPrecise()
+{
+    return precise;
+}
+
+void CollisionGrid::getCellRange(const Rect &r, int &x0, int &y0, int &x1, int &y1)
+{
+    x0 = std::min(std::max((int)std::floor(r.left / CELL_WIDTH), 0), cols - 1);
+    y0 = std::min(std::max((int)std::floor(r.top / CELL_HEIGHT), 0), rows - 1);
+    x1 = std::min(std::max((int)std::floor((r.left + r.width) / CELL_WIDTH), 0), cols - 1);
+    y1 = std::min(std::max((int)std::floor((r.top + r.height) / CELL_HEIGHT), 0), rows - 1);
+}
+
+void CollisionGrid::fill(const std::vector<Rect> &boxes, std::vector<int> &start, std::vector<int> &items, ItemBoxes &itemBoxes)
+{
+    int x0, y0, x1, y1;
+    //Count the boxes in every cell. The count of cell c is stored in start[c+1].
+    start.assign(cols*rows + 1, 0);
+    for (size_t i = 0; i < boxes.size(); i++)
+    {
+        getCellRange(boxes[i],x0,y0,x1,y1);
+        for (int y = y0; y <= y1; y++)
+            for (int x = x0; x <= x1; x++)
+                start[y*cols + x + 1]++;
+    }
+    //Turn the counts into offsets
+    for (int c = 0; c < cols*rows; c++)
+        start[c+1] += start[c];
+
+    //Store the box indices and edges
+    int size = start[cols*rows];
+    items.resize(size);
+    itemBoxes.left.resize(size);
+    itemBoxes.top.resize(size);
+    itemBoxes.right.resize(size);
+    itemBoxes.bottom.resize(size);
+    cursor.assign(start.begin(), start.end() - 1);
+    for (size_t i = 0; i < boxes.size(); i++)
+    {
+        getCellRange(boxes[i],x0,y0,x1,y1);
+        for (int y = y0; y <= y1; y++)
+        {
+            for (int x = x0; x <= x1; x++)
+            {
+                int k = cursor[y*cols + x]++;
+                items[k] = i;
+                itemBoxes.left[k] = boxes[i].left;
+                itemBoxes.top[k] = boxes[i].top;
+                itemBoxes.right[k] = boxes[i].left + boxes[i].width;
+                itemBoxes.bottom[k] = boxes[i].top + boxes[i].height;
+            }
+        }
+    }
+}
+
+template<typename Hit>
+void CollisionGrid::forEachHit(int cell, const Rect &r, const std::vector<int> &start, const ItemBoxes &itemBoxes, Hit hit)
+{
+    //Most cells hold only a few objects. The kernel only pays off for crowded cells.
+    float right = r.left + r.width;
+    float bottom = r.top + r.height;
+    if(start[cell+1] - start[cell] < Kernels::MIN_BOXES)
+    {
+        for (int k = start[cell]; k < start[cell+1]; k++)
+        {
+            if(std::max(itemBoxes.left[k], r.left) < std::min(itemBoxes.right[k], right)
+               && std::max(itemBoxes.top[k], r.top) < std::min(itemBoxes.bottom[k], bottom))
+                hit(k);
+        }
+        return;
+    }
+    //The kernel gives the hits in slices, so that the indices fit on the stack
+    const int SLICE = 64;
+    int hits[SLICE];
+    for (int first = start[cell]; first < start[cell+1]; first += SLICE)
+    {
+        int n = std::min(SLICE, start[cell+1] - first);
+        int count = Kernels::findIntersections(&itemBoxes.left[first],&itemBoxes.top[first],&itemBoxes.right[first],
+                                               &itemBoxes.bottom[first],n,r.left,r.top,right,bottom,hits);
+        for (int k = 0; k < count; k++)
+            hit(first + hits[k]);
+    }
+}
+
+void CollisionGrid::setObstacles(const World &world)
+{
+    obstacleBoxes.resize(world.getSize());
+    for (int i = 0; i < world.getSize(); i++)
+        obstacleBoxes[i] = hitboxes->getObjectBox(world.getType(i),world.getPosition(i));
+    fill(obstacleBoxes,obstacleStart,obstacleItems,obstacleItemBoxes);
+}
+
+void CollisionGrid::setPlayers(Player *players, int np, WorkerPool *pool)
+{
+    playerBoxes.resize(np);
+    playerPos.resize(np);
+    playerState.resize(np);
+    playerTeam.resize(np);
+    forRange(pool,np,Simulation::PLAYER_CHUNK_SIZE,[&](int begin, int end)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            playerPos[i] = players[i].getPosition();
+            playerState[i] = players[i].getState();
+            playerTeam[i] = players[i].getTeam();
+            playerBoxes[i] = players[i].getHitbox(*hitboxes);
+        }
+    });
+    fill(playerBoxes,playerStart,playerItems,playerItemBoxes);
+}
+
+int CollisionGrid::findPlayer(const Rect &r, int ignoreTeam)
+{
+    int x0, y0, x1, y1;
+    getCellRange(r,x0,y0,x1,y1);
+    int found = -1;
+    for (int y = y0; y <= y1; y++)
+    {
+        for (int x = x0; x <= x1; x++)
+        {
+            forEachHit(y*cols + x,r,playerStart,playerItemBoxes,[&](int k)
+            {
+                int i = playerItems[k];
+                if((found == -1 || i < found) && playerTeam[i] != ignoreTeam)
+                {
+                    if(!precise || hitboxes->hitsSoldier(playerPos[i],playerState[i],r))
+                        found = i;
+                }
+            });
+        }
+    }
+    return found;
+}
+
+int CollisionGrid::findObstacle(const Rect &r, const World &world)
+{
+    int x0, y0, x1, y1;
+    getCellRange(r,x0,y0,x1,y1);
+    int found = -1;
+    for (int y = y0; y <= y1; y++)
+    {
+        for (int x = x0; x <= x1; x++)
+        {
+            forEachHit(y*cols + x,r,obstacleStart,obstacleItemBoxes,[&](int k)
+            {
+                int i = obstacleItems[k];
+                if((found == -1 || i < found) && world.isAlive(i))
+                {
+                    if(!precise || hitboxes->hitsObject(world.getType(i),world.getPosition(i),r))
+                        found = i;
+                }
+            });
+        }
+    }
+    return found;
+}
+
+BulletPool::BulletPool(int capacity, int width, int height)
+{
+    this->capacity = capacity;
+    this->width = width;
+    this->height = height;
+    count = 0;
+    x = new float[capacity];
+    y = new float[capacity];
+    prevX = new float[capacity];
+    prevY = new float[capacity];
+    speed = new float[capacity];
+    dir = new unsigned char[capacity];
+    owner = new int[capacity];
+}
+
+bool BulletPool::add(Coord pos, int state, float speed, int owner)
+{
+    if(count == capacity)
+        return false;
+
+    //Determine the bullet direction and position based on soldier's state.
+    //The position is determined so that the bullet comes out from the tip of the rifle.
+    TravelDirection bullet_dir;
+    Coord bullet_pos;
+
+    if(state == 0 || state == 7 || state == 8)
+    {
+        bullet_dir = Up;
+        bullet_pos.x = pos.x + 60;
+        bullet_pos.y = pos.y - 2 ;
+    }
+    else if(state == 2 || state == 9 || state == 10)
+    {
+        bullet_dir = Right;
+        bullet_pos.x = pos.x + 109;
+        bullet_pos.y = pos.y + 75;
+    }
+    else if(state == 6 || state == 12 || state == 13)
+    {
+        bullet_dir = Left;
+        bullet_pos.x = pos.x + 5;
+        bullet_pos.y = pos.y + 38;
+    }
+    else if(state == 3 || state == 4 || state == 11)
+    {
+        bullet_dir = Down;
+        bullet_pos.x = pos.x + 30;
+        bullet_pos.y = pos.y + 95;
+    }
+    else //The rifle is pointing diagonally, see Player::canShoot()
+        return false;
+
+    //Append the bullet to the end of the arrays.
+    x[count] = bullet_pos.x;
+    y[count] = bullet_pos.y;
+    prevX[count] = bullet_pos.x;
+    prevY[count] = bullet_pos.y;
+    this->speed[count] = speed;
+    dir[count] = bullet_dir;
+    this->owner[count] = owner;
+    count++;
+    return true;
+}
+
+void BulletPool::remove(int i)
+{
+    //Move the last bullet into the freed slot.
+    count--;
+    x[i] = x[count];
+    y[i] = y[count];
+    prevX[i] = prevX[count];
+    prevY[i] = prevY[count];
+    speed[i] = speed[count];
+    dir[i] = dir[count];
+    owner[i] = owner[count];
+}
+
+void BulletPool::checkCollision(CollisionGrid *grid, Player* players, World &world, int np, std::vector<int> &destroyed,
+                                WorkerPool *pool)
+{
+    if(count == 0)
+        return;
+    //Put the players into the grid at their current positions. The obstacles are already there.
+    grid->setPlayers(players,np,pool);
+
+    //Test every bullet against the objects in the cells it overlaps. The players are checked first, then
+    //the entities. If a bullet overlaps several objects of a kind, the one with the lowest index is hit.
+    //Nothing is changed here, so the bullets can be tested in any order.
+    hitPlayer.resize(count);
+    hitObstacle.resize(count);
+    forRange(pool,count,CHUNK_SIZE,[&](int begin, int end)
+    {
+        for (int j = begin; j < end; j++)
+        {
+            //We use the Rect::intersects() function to check for collision.
+            Rect bullet_rect = getBounds(j);
+            int shooter = owner[j];
+            hitPlayer[j] = grid->findPlayer(bullet_rect, shooter == -1 ? -1 : players[shooter].getTeam());
+            hitObstacle[j] = hitPlayer[j] == -1 ? grid->findObstacle(bullet_rect,world) : -1;
+        }
+    });
+
+    //Apply the hits in the order of the bullets. order follows the bullets as remove() moves them around.
+    order.resize(count);
+    for (int j = 0; j < count; j++)
+        order[j] = j;
+    int j = 0;
+    while(j < count)
+    {
+        int k = order[j];
+        int player = hitPlayer[k];
+        int obstacle = hitObstacle[k];
+        //An earlier bullet may have destroyed the entity in the meantime. Then the bullet flies on,
+        //unless it hits another entity behind it.
+        if(obstacle != -1 && !world.isAlive(obstacle))
+            obstacle = grid->findObstacle(getBounds(j),world);
+        if(player == -1 && obstacle == -1) //next bullet
+        {
+            j++;
+            continue;
+        }
+
+        //delete bullet, the last bullet is moved to index j, so do not advance
+        int shooter = owner[j];
+        remove(j);
+        order[j] = order[count];
+        if(player != -1) //Increment score and respawn
+        {
+            if(shooter != -1)
+                players[shooter].incrementScore();
+            players[player].setRespawnFlag(1);
+        }
+        else if(world.damage(obstacle))
+            destroyed.push_back(obstacle);
+    }
+}
+
+void BulletPool::update(WorkerPool *pool)
+{
+    outside.resize(count);
+    forRange(pool,count,CHUNK_SIZE,[&](int begin, int end)
+    {
+        Kernels::moveBullets(x + begin,y + begin,prevX + begin,prevY + begin,speed + begin,dir + begin,end - begin,
+                             width,height,&outside[begin]);
+    });
+
+    //Remove the bullets that have left the battlefield. They can not hit anything out there.
+    //The flags move along with the bullets.
+    int i = 0;
+    while(i < count)
+    {
+        if(outside[i])
+        {
+            remove(i);
+            outside[i] = outside[count];
+        }
+        else
+            i++;
+    }
+}
+
+int BulletPool::getCount()
+{
+    return count;
+}
+
+int BulletPool::getCapacity()
+{
+    return capacity;
+}
+
+Coord BulletPool::getPosition(int i)
+{
+    return Coord(x[i],y[i]);
+}
+
+Coord BulletPool::getPrevPosition(int i)
+{
+    return Coord(prevX[i],prevY[i]);
+}
+
+BulletPool::TravelDirection BulletPool::getDirection(int i)
+{
+    return (TravelDirection)dir[i];
+}
+
+int BulletPool::getOwner(int i)
+{
+    return owner[i];
+}
+
+Rect BulletPool::getBounds(int i)
+{
+    //Horizontal bullets are drawn rotated by 90 degrees around the bullet position,
+    //so the sprite extends to the left of the position.
+    if(dir[i] == Left || dir[i] == Right)
+        return Rect(x[i] - BULLET_LENGTH,y[i],BULLET_LENGTH,BULLET_WIDTH);
+    return Rect(x[i],y[i],BULLET_WIDTH,BULLET_LENGTH);
+}
+
+void BulletPool::saveState(std::vector<unsigned char> &buffer)
+{
+    writeState(buffer,count);
+    writeState(buffer,x,count);
+    writeState(buffer,y,count);
+    writeState(buffer,prevX,count);
+    writeState(buffer,prevY,count);
+    writeState(buffer,speed,count);
+    writeState(buffer,dir,count);
+    writeState(buffer,owner,count);
+}
+
+bool BulletPool::loadState(const std::vector<unsigned char> &buffer, size_t &offset)
+{
+    int n;
+    size_t start = offset;
+    if(!readState(buffer,offset,n) || n < 0 || n > capacity)
+    {
+        offset = start;
+        return false;
+    }
+    if(offset + n*(5*sizeof(float) + sizeof(unsigned char) + sizeof(int)) > buffer.size())
+    {
+        offset = start;
+        return false;
+    }
+    count = n;
+    readState(buffer,offset,x,count);
+    readState(buffer,offset,y,count);
+    readState(buffer,offset,prevX,count);
+    readState(buffer,offset,prevY,count);
+    readState(buffer,offset,speed,count);
+    readState(buffer,offset,dir,count);
+    readState(buffer,offset,owner,count);
+    return true;
+}
+
+BulletPool::~BulletPool()
+{
+    delete[] x;
+    delete[] y;
+    delete[] prevX;
+    delete[] prevY;
+    delete[] speed;
+    delete[] dir;
+    delete[] owner;
+}
+
+Coord Player::getPosition()
+{
+    return pos;
+}
+
+void Player::init(Coord pos)
+{
+    this->pos = pos;
+    state = 0;
+    s = 0;
+    score = 0;
+    respawnFlag = 0;
+    prevPos = pos;
+    //Allow shooting right away
+    lastShot = -1000000;
+    pressedDir[0] = None;
+    pressedDir[1] = None;
+}
+
+Rect Player::getBounds()
+{
+    return Rect(pos.x,pos.y,SOLDIER_SIZE,SOLDIER_SIZE);
+}
+
+Rect Player::getHitbox(const HitboxTable &table)
+{
+    return table.getSoldierBox(pos,state);
+}
+
+void Player::setPosition(Coord pos)
+{
+    this->pos = pos;
+}
+
+Coord Player::getPrevPosition()
+{
+    return prevPos;
+}
+
+void Player::savePosition()
+{
+    prevPos = pos;
+}
+
+void Player::incrementScore()
+{
+    score++;
+}
+
+const int Player::getScore()
+{
+    return score;
+}
+
+int Player::getTeam()
+{
+    return team;
+}
+
+void Player::setTeam(int team)
+{
+    this->team = team;
+}
+
+bool Player::checkCollision(float speed, WalkDirection dir, const ObstacleMap *obstacles, int width, int height)
+{
+    //check collision with barrels and sandbags
+    if(obstacles->isBlocked(pos,dir))
+        return true;
+
+    //check if the soldier is out of bounds.
+    if(dir == Up)
+        return pos.y + 16 - speed < 0;
+    else if(dir == Right)
+        return pos.x + 90 + speed > width;
+    else if(dir == Left)
+        return pos.x - speed < 0;
+    else //dir == Down
+        return pos.y + 95 + speed > height;
+}
+
+void Player::walk(float speed, WalkDirection dir, const ObstacleMap *obstacles, int width, int height)
+{
+    //State machine for the soldier, exactly as shown in the document.
+    switch (state)
+    {
+    case 0:
+        if(dir == Up && s==1) //walk up
+        {
+            state = 8;
+            if(this->checkCollision(speed,dir,obstacles,width,height))
+                return;
+            pos.y -= speed;
+        }
+        else if(dir == Up && s==0) //walk up
+        {
+            state = 7;
+            if(this->checkCollision(speed,dir,obstacles,width,height))
+                return;
+            pos.y -= speed;
+        }
+        else if(dir == Right || dir == Down) //turn clockwise
+        {
+            state = 1;
+        }
+        else if(dir == Left) //turn counter-clockwise
+        {
+            state = 7;
+        }
+        break;
+
+    case 1:
+        if(dir == Up || dir == Left) //turn counter-clockwise
+        {
+            state = 0;
+        }
+        else if(dir == Down || dir == Right) //turn clockwise
+        {
+            state = 2;
+        }
+        break;
+
+    case 2:
+        if(dir == Right && s==1) //walk right
+        {
+            state = 9;
+            if(this->checkCollision(speed,dir,obstacles,width,height))
+                return;
+            pos.x += speed;
+        }
+        else if(dir == Right && s==0) //walk right
+        {
+            state = 10;
+            if(this->checkCollision(speed,dir,obstacles,width,height))
+                return;
+            pos.x += speed;
+        }
+        else if(dir == Left || dir == Down) //turn clockwise
+        {
+            state = 3;
+        }
+        else if(dir == Up) //turn counter-clockwise
+        {
+            state = 1;
+        }
+        break;
+
+    case 3:
+        s = 1;
+        if(dir == Down) //Walk down
+        {
+            state = 4;
+            if(this->checkCollision(speed,dir,obstacles,width,height))
+                return;
+            pos.y += speed;
+        }
+        else if(dir == Left || dir == Up) //Turn clockwise
+        {
+            state = 4;
+        }
+        else if(dir == Right) //turn counter-clockwise
+        {
+            state = 2;
+        }
+        break;
+
+    case 4:
+        if(dir == Down && s == 0) //walk down
+        {
+            state = 3;
+            if(this->checkCollision(speed,dir,obstacles,width,height))
+                return;
+            pos.y += speed;
+        }
+        else if(dir == Down && s == 1) //walk down
+        {
+            state = 11;
+            if(this->checkCollision(speed,dir,obstacles,width,height))
+                return;
+            pos.y += speed;
+        }
+        else if(dir == Left || dir == Up) //turn clockwise
+        {
+            state = 5;
+        }
+        else if(dir == Right) //turn counter-clockwise
+        {
+            state = 3;
+        }
+        break;
+
+    case 5:
+        if(dir == Left || dir == Up) //turn clockwise
+        {
+            state = 6;
+        }
+        else if(dir == Right || dir == Down) //turn counter-clockwise
+        {
+            state = 4;
+        }
+        break;
+
+    case 6:
+        if(dir == Left && s == 0) //walk left
+        {
+            state = 13;
+            if(this->checkCollision(speed,dir,obstacles,width,height))
+                return;
+            pos.x -= speed;
+        }
+        else if(dir == Left && s == 1) //walk left
+        {
+            state = 12;
+            if(this->checkCollision(speed,dir,obstacles,width,height))
+                return;
+            pos.x -= speed;
+        }
+        else if(dir == Up || dir == Right) //turn clockwise
+        {
+            state = 7;
+        }
+        else if(dir == Down) //turn counter-clockwise
+        {
+            state = 5;
+        }
+        break;
+
+    case 7:
+        s = 1;
+        if(dir == Up) //walk up
+        {
+            state = 0;
+            if(this->checkCollision(speed,dir,obstacles,width,height))
+                return;
+            pos.y -= speed;
+        }
+        else if(dir == Right) //turn clockwise
+        {
+            state = 0;
+        }
+        else if(dir == Left || dir == Down) //turn counter-clockwise
+        {
+            state = 6;
+        }
+        break;
+
+    case 8:
+        state = 0;
+        s = 0;
+        if(dir == Up) //walk up
+        {
+            if(this->checkCollision(speed,dir,obstacles,width,height))
+                return;
+            pos.y -= speed;
+        }
+        break;
+
+    case 9:
+        state = 2;
+        s = 0;
+        if(dir == Right) //walk right
+        {
+            if(this->checkCollision(speed,dir,obstacles,width,height))
+                return;
+            pos.x += speed;
+        }
+        break;
+
+    case 10:
+        state = 2;
+        s = 1;
+        if(dir == Right) //walk right
+        {
+            if(this->checkCollision(speed,dir,obstacles,width,height))
+                return;
+            pos.x += speed;
+        }
+        break;
+
+    case 11:
+        state = 4;
+        s = 0;
+        if(dir == Down) //walk down
+        {
+            if(this->checkCollision(speed,dir,obstacles,width,height))
+                return;
+            pos.y += speed;
+        }
+        break;
+
+    case 12:
+        state = 6;
+        s = 0;
+        if(dir == Left) //walk left
+        {
+            if(this->checkCollision(speed,dir,obstacles,width,height))
+                return;
+            pos.x -= speed;
+        }
+        break;
+
+    case 13:
+        state = 6;
+        s = 1;
+        if(dir == Left) //walk left
+        {
+            if(this->checkCollision(speed,dir,obstacles,width,height))
+                return;
+            pos.x -= speed;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+Player::WalkDirection Player::getPressed()
+{
+    return pressedDir[0];
+}
+
+void Player::setPressed(WalkDirection dir)
+{
+    if(pressedDir[0] == None)
+        pressedDir[0] = dir;
+    else if(pressedDir[1] == None && pressedDir[0] != dir)
+        pressedDir[1] = dir;
+}
+
+void Player::clearPressed(WalkDirection dir)
+{
+    if(pressedDir[0] == dir)
+    {
+        pressedDir[0] = pressedDir[1];
+        pressedDir[1] = None;
+    }
+    else if(pressedDir[1] == dir)
+    {
+        pressedDir[1] = None;
+    }
+}
+
+const int Player::getState()
+{
+    return state;
+}
+
+const bool Player::canShoot()
+{
+    return (state != 1 && state != 5 && state != 3 && state != 7 && state != 10 && state != 13);
+}
+
+Player::WalkDirection Player::getFacing()
+{
+    if(!canShoot())
+        return None;
+    //Same directions as in BulletPool::add()
+    if(state == 0 || state == 8)
+        return Up;
+    else if(state == 2 || state == 9)
+        return Right;
+    else if(state == 6 || state == 12)
+        return Left;
+    else
+        return Down;
+}
+
+int Player::getRespawnFlag()
+{
+    return respawnFlag;
+}
+
+void Player::setRespawnFlag(int val)
+{
+    respawnFlag = val;
+}
+
+int Player::getLastShot()
+{
+    return lastShot;
+}
+
+void Player::setLastShot(int tick)
+{
+    lastShot = tick;
+}
+
+void Player::respawn(Coord pos)
+{
+    this->pos = pos;
+    prevPos = pos; //Do not slide over to the new position
+    state = 0;
+    s = 0;
+    pressedDir[0] = None;
+    pressedDir[1] = None;
+}
+
+void Player::saveState(std::vector<unsigned char> &buffer)
+{
+    writeState(buffer,pos);
+    writeState(buffer,prevPos);
+    writeState(buffer,state);
+    writeState(buffer,s);
+    writeState(buffer,score);
+    writeState(buffer,respawnFlag);
+    writeState(buffer,lastShot);
+    writeState(buffer,pressedDir,2);
+    writeState(buffer,team);
+}
+
+bool Player::loadState(const std::vector<unsigned char> &buffer, size_t &offset)
+{
+    return readState(buffer,offset,pos) && readState(buffer,offset,prevPos) && readState(buffer,offset,state)
+        && readState(buffer,offset,s) && readState(buffer,offset,score) && readState(buffer,offset,respawnFlag)
+        && readState(buffer,offset,lastShot) && readState(buffer,offset,pressedDir,2) && readState(buffer,offset,team);
+}
+Simulation::Simulation(float s, int w, int h, int nb, int ns, int np, int maxBullets, int tickRate)
+{
+    speed = s;
+    this->tickRate = tickRate;
+    //Scale the distances per tick, so things move equally fast at every tick rate.
+    walkStep = speed * BASE_TICK_RATE / tickRate;
+    bulletStep = (speed + 25) * BASE_TICK_RATE / tickRate;
+    cooldownTicks = std::ceil(SHOOT_COOLDOWN_MS * tickRate / 1000.0);
+    width = w;
+    height = h;
+    occupancy = new OccupancyGrid(width,height);
+    //Leave a cell for every soldier
+    numPlayers = np;
+    numSandbags = std::max(0, std::min(ns, occupancy->getSize() - np));
+    numBarrels = std::max(0, std::min(nb, occupancy->getSize() - np - numSandbags));
+    tickCount = 0;
+
+    for (int i = 0; i < numSandbags; i++)
+        world.create(World::Sandbag);
+    for (int i = 0; i < numBarrels; i++)
+        world.create(World::Barrel);
+    players = new Player[np];
+    setTeams(np);
+
+    bullets = new BulletPool(maxBullets,width,height);
+    grid = new CollisionGrid(width,height,&hitboxes);
+    obstacles = new ObstacleMap(width,height);
+
+    std::random_device rd{};
+    seed = rd();
+    gen.seed(seed);
+    listener = nullptr;
+    pool = nullptr;
+}
+
+Simulation::~Simulation()
+{
+    delete[] players;
+    delete bullets;
+    delete grid;
+    delete obstacles;
+    delete occupancy;
+}
+
+void Simulation::setHitboxes(const HitboxTable &table)
+{
+    hitboxes = table;
+}
+
+void Simulation::setPreciseCollision(bool precise)
+{
+    grid->setPrecise(precise);
+}
+
+bool Simulation::getPreciseCollision()
+{
+    return grid->isPrecise();
+}
+
+void Simulation::setSeed(unsigned int seed)
+{
+    this->seed = seed;
+    gen.seed(seed);
+}
+
+unsigned int Simulation::getSeed()
+{
+    return seed;
+}
+
+void Simulation::setInputListener(InputListener *listener)
+{
+    this->listener = listener;
+}
+
+void Simulation::setWorkerPool(WorkerPool *pool)
+{
+    this->pool = pool;
+}
+
+Coord Simulation::takeRandomCell()
+{
+    int cell = occupancy->sample(gen);
+    if(cell == -1)
+        return Coord(0,0);
+    occupancy->occupy(cell);
+    return occupancy->getPosition(cell);
+}
+
+void Simulation::initWarzone()
+{
+    //randomly spawn the sandbags and barrels across the field.
+    for (int i = 0; i < world.getSize(); i++)
+    {
+        world.spawn(i,takeRandomCell());
+        obstacles->setTile(world.getPosition(i),(ObstacleMap::Tile)World::TYPES[world.getType(i)].tile);
+    }
+
+    //randomly spawn the soldiers accross the field, each on its own cell. The soldiers walk away from
+    //their cells, so the cells are freed again once all of them are placed.
+    for (int i = 0; i < numPlayers; i++)
+        players[i].init(takeRandomCell());
+    for (int i = 0; i < numPlayers; i++)
+        occupancy->release(occupancy->getCell(players[i].getPosition()));
+
+    grid->setObstacles(world);
+}
+
+void Simulation::saveState(std::vector<unsigned char> &buffer)
+{
+    //The engine is copied as raw bytes together with the rest of the state
+    static_assert(std::is_trivially_copyable<std::mt19937>::value, "the generator state must be copyable");
+    writeState(buffer,numSandbags);
+    writeState(buffer,numBarrels);
+    writeState(buffer,numPlayers);
+    writeState(buffer,tickCount);
+    writeState(buffer,gen);
+    world.saveState(buffer);
+    for (int i = 0; i < numPlayers; i++)
+        players[i].saveState(buffer);
+    bullets->saveState(buffer);
+    occupancy->saveState(buffer);
+}
+
+bool Simulation::loadState(const std::vector<unsigned char> &buffer)
+{
+    size_t offset = 0;
+    int ns, nb, np;
+    if(!readState(buffer,offset,ns) || !readState(buffer,offset,nb) || !readState(buffer,offset,np))
+        return false;
+    if(ns != numSandbags || nb != numBarrels || np != numPlayers)
+        return false;
+
+    //Read into copies first, so a buffer that does not fit leaves the simulation as it was
+    int ticks;
+    std::mt19937 engine;
+    World worldCopy = world;
+    std::vector<Player> playerCopy(players, players + numPlayers);
+    BulletPool bulletCopy(bullets->getCapacity(),width,height);
+    OccupancyGrid occupancyCopy(width,height);
+    bool ok = readState(buffer,offset,ticks) && readState(buffer,offset,engine);
+    ok = ok && worldCopy.loadState(buffer,offset);
+    for (int i = 0; ok && i < numPlayers; i++)
+        ok = playerCopy[i].loadState(buffer,offset);
+    size_t bulletOffset = offset;
+    ok = ok && bulletCopy.loadState(buffer,offset) && occupancyCopy.loadState(buffer,offset);
+    if(!ok)
+        return false;
+
+    tickCount = ticks;
+    gen = engine;
+    world = worldCopy;
+    std::copy(playerCopy.begin(), playerCopy.end(), players);
+    //The buffer is known to be valid now, so the bullets and free cells can be read in place
+    bullets->loadState(buffer,bulletOffset);
+    occupancy->loadState(buffer,bulletOffset);
+
+    //The obstacle map and the collision grid are derived from the entities
+    delete obstacles;
+    obstacles = new ObstacleMap(width,height);
+    for (int i = 0; i < world.getSize(); i++)
+    {
+        if(world.isAlive(i))
+            obstacles->setTile(world.getPosition(i),(ObstacleMap::Tile)World::TYPES[world.getType(i)].tile);
+    }
+    grid->setObstacles(world);
+    destroyed.clear();
+    return true;
+}
+
+void Simulation::saveRollbackState(std::vector<unsigned char> &buffer)
+{
+    static_assert(std::is_trivially_copyable<Player>::value, "the players are copied as raw bytes");
+    buffer.clear();
+    writeState(buffer,tickCount);
+    writeState(buffer,gen);
+    world.saveHealth(buffer);
+    writeState(buffer,players,numPlayers);
+    bullets->saveState(buffer);
+    occupancy->saveState(buffer);
+}
+
+void Simulation::loadRollbackState(const std::vector<unsigned char> &buffer)
+{
+    size_t offset = 0;
+    destroyed.clear();
+    readState(buffer,offset,tickCount);
+    readState(buffer,offset,gen);
+    //Put the obstacles of the entities that changed on the map or take them off. destroyed serves as the
+    //scratch list; it is empty after a load anyway.
+    world.loadHealth(buffer,offset,destroyed);
+    for (size_t i = 0; i < destroyed.size(); i++)
+    {
+        int entity = destroyed[i];
+        ObstacleMap::Tile tile = world.isAlive(entity) ? (ObstacleMap::Tile)World::TYPES[world.getType(entity)].tile : ObstacleMap::Empty;
+        obstacles->setTile(world.getPosition(entity),tile);
+    }
+    destroyed.clear();
+    readState(buffer,offset,players,numPlayers);
+    bullets->loadState(buffer,offset);
+    occupancy->loadState(buffer,offset);
+}
+
+void Simulation::setPressed(int player, Player::WalkDirection dir)
+{
+    if(listener)
+        listener->onInput(tickCount,player,InputListener::Press,dir);
+    players[player].setPressed(dir);
+}
+
+void Simulation::clearPressed(int player, Player::WalkDirection dir)
+{
+    if(listener)
+        listener->onInput(tickCount,player,InputListener::Release,dir);
+    players[player].clearPressed(dir);
+}
+
+bool Simulation::shoot(int player)
+{
+    if(listener)
+        listener->onInput(tickCount,player,InputListener::Shoot,Player::None);
+    //Use a cooldown for shooting bullets. Otherwise, players can spam bullets.
+    if(!players[player].canShoot() || tickCount - players[player].getLastShot() < cooldownTicks)
+        return false;
+    if(!bullets->add(players[player].getPosition(),players[player].getState(),bulletStep,player))
+        return false; //Too many bullets in flight
+    players[player].setLastShot(tickCount);
+    return true;
+}
+
+void Simulation::tick()
+{
+    PROFILE_SCOPE("tick");
+    //Move the soldiers first. A soldier only looks at the obstacle map, which does not change while they
+    //walk, so every soldier can walk on its own.
+    {
+        PROFILE_SCOPE("walk");
+        forRange(pool,numPlayers,PLAYER_CHUNK_SIZE,[&](int begin, int end)
+        {
+            for (int i = begin; i < end; i++)
+            {
+                players[i].savePosition();
+                if(players[i].getPressed() != Player::None)
+                    players[i].walk(walkStep,players[i].getPressed(),obstacles,width,height);
+            }
+        });
+    }
+    //Check for collision, then move the bullets and remove the ones that left the battlefield
+    destroyed.clear();
+    {
+        PROFILE_SCOPE("checkCollision");
+        bullets->checkCollision(grid,players,world,numPlayers,destroyed,pool);
+    }
+    {
+        PROFILE_SCOPE("bullet update");
+        bullets->update(pool);
+    }
+
+    {
+        PROFILE_SCOPE("respawn");
+        //Remove the destroyed entities from the occupancy grid and the obstacle map
+        for (size_t i = 0; i < destroyed.size(); i++)
+        {
+            Coord pos = world.getPosition(destroyed[i]);
+            occupancy->release(occupancy->getCell(pos));
+            obstacles->setTile(pos,ObstacleMap::Empty);
+        }
+
+        //Respawn the soldiers that got hit
+        for (int i = 0; i < numPlayers; i++)
+        {
+            if(players[i].getRespawnFlag())
+            {
+                int cell = occupancy->sample(gen);
+                players[i].respawn(cell == -1 ? Coord(0,0) : occupancy->getPosition(cell));
+                players[i].setRespawnFlag(0);
+            }
+        }
+    }
+    tickCount++;
+    if(listener)
+        listener->onTick(this);
+}
+
+void Simulation::setTeams(int teams)
+{
+    numTeams = std::max(1, std::min(teams, numPlayers));
+    for (int i = 0; i < numPlayers; i++)
+        players[i].setTeam(i % numTeams);
+}
+
+int Simulation::getTeamScore(int team)
+{
+    int score = 0;
+    for (int i = team; i < numPlayers; i += numTeams)
+        score += players[i].getScore();
+    return score;
+}
+
+int Simulation::getWinner()
+{
+    for (int i = 0; i < numTeams; i++)
+    {
+        if(getTeamScore(i) >= WINNING_SCORE)
+            return i;
+    }
+    return -1;
+}
+
+int Simulation::getTick()
+{
+    return tickCount;
+}
+
+int Simulation::getTickRate()
+{
+    return tickRate;
+}
+
+float Simulation::getBulletStep()
+{
+    return bulletStep;
+}
+
+const std::vector<int>& Simulation::getDestroyed()
+{
+    return destroyed;
+}
+
+float Simulation::getSpeed()
+{
+    return speed;
+}
+
+int Simulation::getWidth()
+{
+    return width;
+}
+
+int Simulation::getHeight()
+{
+    return height;
+}
+
+int Simulation::getNumBarrels()
+{
+    return numBarrels;
+}
+
+int Simulation::getNumSandbags()
+{
+    return numSandbags;
+}
+
+int Simulation::getNumPlayers()
+{
+    return numPlayers;
+}
+
+int Simulation::getNumTeams()
+{
+    return numTeams;
+}
+
+const World& Simulation::getWorld()
+{
+    return world;
+}
+
+Player* Simulation::getPlayers()
+{
+    return players;
+}
+
+BulletPool* Simulation::getBullets()
+{
+    return bullets;
+}
+
+const ObstacleMap* Simulation::getObstacles()
+{
+    return obstacles;
+}
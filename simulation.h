@@ -0,0 +1,785 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <vector>
+#include <cstdint>
+#include <random>
+#include <cstring>
+
+//Game simulation core. Everything in this file is independent of SFML, so the simulation can run
+//without a window (see headless.cpp). The windowed front end in main.cpp draws the state kept here.
+
+//Sprite sizes in pixels. These must match the images in the textures folder.
+const int SOLDIER_SIZE = 100; //soldierN.png is 100x100
+const int BULLET_WIDTH = 2; //bullet.png is 2x22
+const int BULLET_LENGTH = 22;
+
+//A pixel is solid if its alpha value is at least this much.
+const int ALPHA_THRESHOLD = 128;
+//Radius of the morphological opening applied to the soldier masks. Parts of a soldier that are thinner than
+//2*radius+1 pixels, like the rifle, do not belong to the hitbox. Otherwise soldiers would shoot themselves.
+const int SOLDIER_BODY_RADIUS = 5;
+
+//Size of one cell in the object grid. Objects are always spawned on a cell.
+const int CELL_WIDTH = 60;
+const int CELL_HEIGHT = 92;
+
+//Helpers for saving the state of a match into a byte buffer, see Simulation::saveState().
+//The values are copied byte by byte, so T must be trivially copyable.
+template<typename T>
+void writeState(std::vector<unsigned char> &buffer, const T *values, int n)
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char*>(values);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T)*n);
+}
+
+template<typename T>
+void writeState(std::vector<unsigned char> &buffer, const T &value)
+{
+    writeState(buffer, &value, 1);
+}
+
+//Reads values written by writeState, starting at offset. Advances the offset. Returns false if the buffer
+//is too short, in which case nothing is read.
+template<typename T>
+bool readState(const std::vector<unsigned char> &buffer, size_t &offset, T *values, int n)
+{
+    if(n < 0 || offset + sizeof(T)*n > buffer.size())
+        return false;
+    memcpy(values, buffer.data() + offset, sizeof(T)*n);
+    offset += sizeof(T)*n;
+    return true;
+}
+
+template<typename T>
+bool readState(const std::vector<unsigned char> &buffer, size_t &offset, T &value)
+{
+    return readState(buffer, offset, &value, 1);
+}
+
+//Writes a number in 7 bit groups, least significant first. The high bit of a byte tells if more follow.
+inline void writeVarint(std::vector<unsigned char> &buffer, uint32_t value)
+{
+    while(value >= 0x80)
+    {
+        buffer.push_back((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    buffer.push_back(value);
+}
+
+inline bool readVarint(const std::vector<unsigned char> &buffer, size_t &offset, uint32_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        if(offset >= buffer.size())
+            return false;
+        unsigned char byte = buffer[offset++];
+        value |= (uint32_t)(byte & 0x7f) << shift;
+        if(!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+class Coord
+{
+public:
+    float x,y;
+    Coord();
+    Coord(float,float);
+};
+
+//Axis aligned rectangle. Behaves exactly like sf::FloatRect, which the game used before the simulation
+//was separated from the rendering code.
+class Rect
+{
+public:
+    float left, top, width, height;
+    Rect();
+    Rect(float left, float top, float width, float height);
+
+    //Returns true if the two rectangles overlap. Touching edges do not count as an overlap.
+    bool intersects(const Rect &other) const;
+};
+
+//Solid pixels of a sprite, packed into 64-bit words. Each row starts with a new word and bit i of word k
+//holds the pixel at x = 64*k + i. Used for exact hit detection without reading any texture.
+class BitMask
+{
+    int width; //Mask width in pixels
+    int height; //Mask height in pixels
+    int words; //Number of words per row
+    std::vector<uint64_t> bits; //Rows of the mask
+public:
+    BitMask();
+
+    /*
+    @brief
+        Builds the mask from an image.
+    @params
+        rgba: Pixels of the image, 4 bytes per pixel, row by row
+        width: Image width
+        height: Image height
+        radius: If not 0, a morphological opening with a square of size 2*radius+1 is applied to the solid
+                pixels, which removes the parts thinner than the square.
+    */
+    void create(const unsigned char *rgba, int width, int height, int radius);
+
+    //Returns true if the mask has been created
+    bool isLoaded() const;
+
+    //Computes the bounding box of the solid pixels. Returns false if there are none.
+    bool getBoundingBox(int &left, int &top, int &width, int &height) const;
+
+    //Returns true if a solid pixel lies in the rectangle. The rectangle is given in mask coordinates.
+    bool overlaps(const Rect &r) const;
+};
+
+//Hitbox of a sprite relative to the sprite position. Sprites are small, so a byte per value is enough.
+struct Hitbox
+{
+    unsigned char left, top, width, height;
+};
+
+//The static objects of the battlefield (sandbags and barrels) as entities. An entity is an index into dense
+//component arrays, one array per component, so every system walks only the data it needs: the collision
+//grid and the obstacle map read positions and types, drawing reads positions, types and health.
+//What an entity is follows from its type, which is a row of TYPES rather than a class, so a new kind of
+//object needs a new row and an image, nothing else.
+//Entities are never removed during a match. A destroyed entity keeps its index, with no health left.
+class World
+{
+public:
+    enum Type {Sandbag,Barrel,NUM_TYPES};
+
+    //What the entities of a type have in common
+    struct TypeInfo
+    {
+        const char *image; //Image of the entity
+        Hitbox hitbox; //Built-in hitbox, used until the image is loaded (see HitboxTable)
+        int tile; //ObstacleMap::Tile the entity puts on its cell
+        int health; //Number of hits the entity takes before it is destroyed, 0 if it can not be destroyed
+    };
+    static const TypeInfo TYPES[NUM_TYPES];
+private:
+    std::vector<Coord> position; //Position component
+    std::vector<unsigned char> type; //Type component, one of the Type values
+    std::vector<unsigned char> health; //Health component, the hits left. Unused if the type can not be destroyed.
+public:
+    //Adds an entity of the given type at (0,0) and returns its index
+    int create(Type type);
+
+    //Puts the entity at the given position with full health
+    void spawn(int entity, Coord pos);
+
+    //Returns the number of entities
+    int getSize() const;
+
+    Coord getPosition(int entity) const;
+
+    Type getType(int entity) const;
+
+    //Returns false once the entity has been destroyed
+    bool isAlive(int entity) const;
+
+    //Takes one hit of health from the entity. Returns true if the hit destroyed it.
+    bool damage(int entity);
+
+    //Appends the positions and the health of the entities to the buffer. The types are not saved, they
+    //follow from the settings of the match.
+    void saveState(std::vector<unsigned char> &buffer);
+
+    //Restores a state saved by saveState into the same entities. Returns false if the buffer is too short.
+    bool loadState(const std::vector<unsigned char> &buffer, size_t &offset);
+
+    //Appends the health of the entities to the buffer as one block. The positions do not change after the
+    //entities are spawned, so the health is all that a rollback needs.
+    void saveHealth(std::vector<unsigned char> &buffer);
+
+    //Restores the health saved by saveHealth. The entities that were destroyed or came back are appended to
+    //changed. Returns false if the buffer is too short.
+    bool loadHealth(const std::vector<unsigned char> &buffer, size_t &offset, std::vector<int> &changed);
+};
+
+//Hitboxes of the soldiers (one per state) and of each type of entity. They are generated from the alpha
+//channel of the images when the front end loads them. The table also keeps the bit masks for precise
+//collisions. Without images (e.g. in the headless runner) the built-in boxes are used, which were generated
+//from the images in the textures folder in the same way; precise collisions then fall back to the boxes.
+class HitboxTable
+{
+    Hitbox soldier[14]; //Indexed by Player::getState()
+    Hitbox object[World::NUM_TYPES]; //Indexed by World::Type
+    BitMask soldierMask[14];
+    BitMask objectMask[World::NUM_TYPES];
+
+    //Creates the mask and the box from an image
+    static void load(BitMask &mask, Hitbox &box, const unsigned char *rgba, int width, int height, int radius);
+    //Returns the hitbox at the given position in world coordinates
+    static Rect place(const Hitbox &box, Coord pos);
+    //Returns true if the mask at the given position overlaps r. Returns true if the mask is not loaded.
+    static bool test(const BitMask &mask, Coord pos, const Rect &r);
+public:
+    //Initializes the table with the built-in boxes
+    HitboxTable();
+
+    //Generates the soldier hitbox of a state from the RGBA pixels of its image
+    void setSoldier(int state, const unsigned char *rgba, int width, int height);
+
+    //Generates the hitbox of a type of entity from the RGBA pixels of its image
+    void setObject(World::Type type, const unsigned char *rgba, int width, int height);
+
+    //Return the hitboxes in world coordinates
+    Rect getSoldierBox(Coord pos, int state) const;
+    Rect getObjectBox(World::Type type, Coord pos) const;
+
+    //Precise tests. These only need to be called if the rectangle intersects the hitbox.
+    bool hitsSoldier(Coord pos, int state, const Rect &r) const;
+    bool hitsObject(World::Type type, Coord pos, const Rect &r) const;
+};
+
+class ObstacleMap;
+
+class Player
+{
+    Coord pos; //Position of the soldier
+    int state; //Primary state of the player (range 0-13)
+    int s; //Secondary state variable
+    int score; //Score of the player
+    int respawnFlag; //1 if player needs to respawn, 0 if not. Basically a flag.
+    int lastShot; //Tick of the last shot
+    int team = 0; //Bullets do not hit soldiers of the team of their owner
+    Coord prevPos; //Position before the last tick, used for drawing between two ticks
+
+public:
+    enum WalkDirection {Left,Up,Right,Down,None};
+private:
+    //Input buffer. This array holds the 2 most recent pressed keys. This ensures a smoother movement,
+    //especially when changing directions.
+    WalkDirection pressedDir[2];
+public:
+
+    //Puts the soldier at the given position, with no score
+    void init(Coord pos);
+
+    //Returns the position of the soldier
+    Coord getPosition();
+
+    //Returns the bounds of the soldier sprite
+    Rect getBounds();
+
+    //Returns the part of the sprite a bullet can hit. It depends on the state of the soldier.
+    Rect getHitbox(const HitboxTable &table);
+
+    //Sets player position
+    void setPosition(Coord pos);
+
+    //Returns the position before the last tick
+    Coord getPrevPosition();
+
+    //Remembers the current position as the previous position. Called at the start of every tick.
+    void savePosition();
+
+    /*
+    @brief
+        Checks whether player collides with one of the other objects
+    @params
+        speed: Player movement speed, used when checking boundaries
+        dir: One of the WalkDirection enum values (Left, Up, Right, Down)
+        obstacles: Map of the sandbags and the barrels
+        width: Width of the battlefield
+        height: Height of the battlefield
+    */
+    bool checkCollision(float speed, WalkDirection dir, const ObstacleMap *obstacles, int width, int height);
+
+    /*
+    @brief
+        Moves the player around
+    @params
+        speed: Player movement speed
+        dir: One of the WalkDirection enum values (Left, Up, Right, Down)
+        obstacles: Map of the sandbags and the barrels
+        width: Width of the battlefield
+        height: Height of the battlefield
+    */
+    void walk(float speed, WalkDirection dir, const ObstacleMap *obstacles, int width, int height);
+
+    //Returns the current travel direction of the player, which is the first element in the pressedDir array.
+    WalkDirection getPressed();
+
+    //Appends a new direction to the pressedDir array
+    void setPressed(WalkDirection dir);
+
+    //Clears the direction from the pressedDir array
+    void clearPressed(WalkDirection dir);
+
+    //Returns the state variable
+    const int getState();
+
+    //Returns true if the soldier is in an appropriate state to shoot. A soldier can only shoot a bullet
+    //if the rifle is pointing up, down, left or right; but not diagonal.
+    const bool canShoot();
+
+    //Returns the direction a bullet fired now would fly in, None if the soldier can not shoot
+    WalkDirection getFacing();
+
+    //Returns the current score of the player
+    const int getScore();
+
+    //Increments score by 1
+    void incrementScore();
+
+    int getTeam();
+
+    void setTeam(int team);
+
+    int getRespawnFlag();
+
+    void setRespawnFlag(int val);
+
+    //Returns the tick of the last shot
+    int getLastShot();
+
+    void setLastShot(int tick);
+
+    //Moves the soldier to the given position and resets its state, after it got hit.
+    void respawn(Coord pos);
+
+    //Appends the complete state of the soldier to the buffer
+    void saveState(std::vector<unsigned char> &buffer);
+
+    //Restores a state saved by saveState. Returns false if the buffer is too short.
+    bool loadState(const std::vector<unsigned char> &buffer, size_t &offset);
+};
+
+//Tile map of the static obstacles, one tile per 60x92 cell. Obstacles are always placed on a cell and a cell
+//holds at most one object, so a soldier can only be blocked by the obstacles in the few cells around it.
+//Checking a move therefore takes a handful of tile lookups, no matter how many obstacles there are.
+class ObstacleMap
+{
+public:
+    enum Tile {Empty,Sandbag,Barrel};
+private:
+    int cols; //Number of cells in x direction
+    int rows; //Number of cells in y direction
+    std::vector<unsigned char> tiles; //One of the Tile values per cell
+public:
+    /*
+    @brief
+        Non-default constructor. All the tiles are initially empty.
+    @params
+        width: Battlefield width
+        height: Battlefield height
+    */
+    ObstacleMap(int width, int height);
+
+    //Sets the tile of the cell at the given position. Used when an obstacle is placed or destroyed.
+    void setTile(Coord pos, Tile tile);
+
+    //Returns true if a soldier at the given position can not walk in the given direction because of an
+    //obstacle. The battlefield borders are not checked here.
+    bool isBlocked(Coord pos, Player::WalkDirection dir) const;
+};
+
+//Keeps track of which 60x92 cells hold an object, for placing the objects and respawning the soldiers.
+//Besides the occupancy bits, the free cells are kept in a packed array, so a uniformly random free cell
+//can be drawn in O(1) no matter how full the battlefield is. Occupying and releasing a cell are O(1) too.
+class OccupancyGrid
+{
+    int cols; //Number of cells in x direction
+    int rows; //Number of cells in y direction
+    std::vector<uint64_t> bits; //One bit per cell, 1 means the cell is occupied
+    std::vector<int> freeCells; //The free cells, in no particular order
+    std::vector<int> freeIndex; //Index of each cell in freeCells, -1 if the cell is occupied
+    std::vector<int> loaded; //Scratch array for loadState(), so a rollback does not allocate
+public:
+    /*
+    @brief
+        Non-default constructor. All the cells are initially free.
+    @params
+        width: Battlefield width
+        height: Battlefield height
+    */
+    OccupancyGrid(int width, int height);
+
+    //Returns the number of cells
+    int getSize() const;
+
+    //Returns the number of free cells
+    int getFreeCount() const;
+
+    //Returns the cell that contains the given position
+    int getCell(Coord pos) const;
+
+    //Returns the position of the top left corner of the cell
+    Coord getPosition(int cell) const;
+
+    bool isOccupied(int cell) const;
+
+    //Marks the cell as occupied. Does nothing if it is already occupied.
+    void occupy(int cell);
+
+    //Marks the cell as free. Does nothing if it is already free.
+    void release(int cell);
+
+    //Returns a uniformly random free cell, -1 if there is none
+    int sample(std::mt19937 &gen) const;
+
+    //Appends the free cells to the buffer. Their order decides which cell sample() picks, so it is
+    //part of the state of a match.
+    void saveState(std::vector<unsigned char> &buffer);
+
+    //Restores a state saved by saveState. Returns false if the buffer does not fit this grid.
+    bool loadState(const std::vector<unsigned char> &buffer, size_t &offset);
+};
+
+//Uniform grid used as the broadphase for bullet collisions. It uses the same 60x92 cells as the object grid.
+class WorkerPool;
+
+//Every object is stored in each cell its hitbox overlaps, so a bullet only has to be tested against the
+//objects in the cells it overlaps instead of every object on the battlefield.
+//The cell contents are kept in compressed form: the objects in cell c are items[start[c]] ... items[start[c+1]-1].
+class CollisionGrid
+{
+    //Edges of the boxes in the order of the items, so that the boxes of a cell lie next to each other and
+    //can be tested together with Kernels::findIntersections
+    struct ItemBoxes
+    {
+        std::vector<float> left;
+        std::vector<float> top;
+        std::vector<float> right;
+        std::vector<float> bottom;
+    };
+
+    int cols; //Number of cells in x direction
+    int rows; //Number of cells in y direction
+    const HitboxTable *hitboxes; //Hitboxes of the objects
+    bool precise; //Use the bit masks after a box test passed
+
+    //Entities of the world, stored by entity index
+    std::vector<int> obstacleStart;
+    std::vector<int> obstacleItems;
+    ItemBoxes obstacleItemBoxes;
+    std::vector<Rect> obstacleBoxes; //Hitboxes of the entities
+
+    //Players, rebuilt every tick since the players move.
+    std::vector<int> playerStart;
+    std::vector<int> playerItems;
+    ItemBoxes playerItemBoxes;
+    std::vector<Rect> playerBoxes; //Hitboxes of the players
+    std::vector<Coord> playerPos; //Positions and states of the players, needed for the bit masks
+    std::vector<int> playerState;
+    std::vector<int> playerTeam; //Teams of the players
+
+    std::vector<int> cursor; //Scratch array used when filling the cells
+
+    //Computes the range of cells overlapped by the rectangle. Coordinates outside the grid are clamped
+    //to the border cells.
+    void getCellRange(const Rect &r, int &x0, int &y0, int &x1, int &y1);
+
+    //Puts the boxes into the cells they overlap. The index of each box is stored in items, its edges
+    //in itemBoxes.
+    void fill(const std::vector<Rect> &boxes, std::vector<int> &start, std::vector<int> &items, ItemBoxes &itemBoxes);
+
+    //Calls hit(item) for every item of the cell whose box intersects the rectangle, in the order of the items
+    template<typename Hit>
+    void forEachHit(int cell, const Rect &r, const std::vector<int> &start, const ItemBoxes &itemBoxes, Hit hit);
+public:
+    /*
+    @brief
+        Non-default constructor
+    @params
+        width: Battlefield width
+        height: Battlefield height
+        hitboxes: Hitboxes of the objects. The table must outlive the grid.
+    */
+    CollisionGrid(int width, int height, const HitboxTable *hitboxes);
+
+    //Enables or disables precise collisions. If enabled, objects are hit only if the bullet overlaps
+    //a solid pixel of the object.
+    void setPrecise(bool precise);
+
+    bool isPrecise();
+
+    //Puts the entities of the world into the grid. Needs to be called once they are placed.
+    //Destroyed entities may stay in the grid, they are skipped by findObstacle().
+    void setObstacles(const World &world);
+
+    //Puts the players into the grid, replacing the previous player positions. The hitboxes are computed in
+    //parallel on the pool if one is given.
+    void setPlayers(Player *players, int np, WorkerPool *pool = nullptr);
+
+    //Returns the lowest index of the players whose hitbox intersects the rectangle, or -1 if there is none.
+    //Players of the team ignoreTeam are skipped; pass -1 to test every player.
+    int findPlayer(const Rect &r, int ignoreTeam = -1);
+
+    //Returns the lowest index of the entities that are alive and intersect the rectangle, or -1 if there is none.
+    //The world must be the one given to setObstacles().
+    int findObstacle(const Rect &r, const World &world);
+};
+
+//Fixed capacity storage for the bullets in flight. The bullet data is kept in separate contiguous arrays
+//(struct of arrays), so moving and testing the bullets walks through memory linearly. Bullets are spawned
+//at the end of the arrays and removed by moving the last bullet into the freed slot, both in O(1).
+//The order of the bullets therefore changes when a bullet is removed.
+class BulletPool
+{
+public:
+    enum TravelDirection {Left,Up,Right,Down};
+private:
+    int capacity; //Maximum number of bullets in flight
+    int count; //Number of bullets in flight
+    int width; //Battlefield width, bullets leaving the battlefield are removed
+    int height; //Battlefield height
+    float *x; //Bullet positions
+    float *y;
+    float *prevX; //Bullet positions before the last update, used for drawing between two ticks
+    float *prevY;
+    float *speed; //Bullet speeds
+    int *owner; //Indices of the players who fired the bullets, -1 if nobody did
+    unsigned char *dir; //Bullet travel directions, one of the TravelDirection values
+
+    //Results of the parallel part of checkCollision(), by bullet index at the start of the test
+    std::vector<int> hitPlayer; //Player hit by the bullet, -1 if none
+    std::vector<int> hitObstacle; //Entity hit by the bullet, -1 if none
+    std::vector<int> order; //Index at the start of the test of the bullet in each slot
+    std::vector<unsigned char> outside; //Bullets that left the battlefield in update()
+public:
+    static const int CHUNK_SIZE = 256; //Number of bullets per chunk when a pool splits the work
+    /*
+    @brief
+        Non-default constructor
+    @params
+        capacity: Maximum number of bullets in flight
+        width: Battlefield width
+        height: Battlefield height
+    */
+    BulletPool(int capacity, int width, int height);
+
+    //Adds a new bullet at the given coordinate and speed. The state parameter is needed to determine the
+    //travel direction of the bullet. Returns false if the pool is full, in which case no bullet is added.
+    //owner is the index of the player who fired it, -1 for none.
+    bool add(Coord pos, int state, float speed, int owner = -1);
+
+    //Removes the bullet at the given index. The last bullet is moved into its place.
+    void remove(int i);
+
+    //Moves every bullet, and removes the bullets that left the battlefield. The bullets are moved in parallel
+    //on the pool if one is given.
+    void update(WorkerPool *pool = nullptr);
+
+    //Checks collision for every bullet. A bullet is destroyed when it collides with a soldier or an entity
+    //of the world; soldiers are tested first. Bullets fly through the soldiers of the team of their owner.
+    //When a soldier is hit, the owner of the bullet scores and the soldier respawns. An entity that is hit
+    //takes damage.
+    //The grid must contain the entities; the players are put into it here.
+    //The indices of the entities destroyed by the bullets are appended to destroyed.
+    //If a pool is given, the bullets are tested in parallel and the hits are applied afterwards in the order
+    //of the bullets, so the outcome is the same as without a pool.
+    void checkCollision(CollisionGrid *grid, Player* players, World &world, int np, std::vector<int> &destroyed,
+                        WorkerPool *pool = nullptr);
+
+    //Returns the number of bullets in flight
+    int getCount();
+
+    //Returns the maximum number of bullets in flight
+    int getCapacity();
+
+    //Returns the position of the bullet at the given index
+    Coord getPosition(int i);
+
+    //Returns the position of the bullet at the given index before the last update
+    Coord getPrevPosition(int i);
+
+    //Returns the travel direction of the bullet at the given index
+    TravelDirection getDirection(int i);
+
+    //Returns the index of the player who fired the bullet at the given index, -1 if nobody did
+    int getOwner(int i);
+
+    //Returns the hitbox of the bullet at the given index
+    Rect getBounds(int i);
+
+    //Appends the bullets in flight to the buffer
+    void saveState(std::vector<unsigned char> &buffer);
+
+    //Restores a state saved by saveState. Returns false if the buffer is too short or holds more
+    //bullets than the capacity.
+    bool loadState(const std::vector<unsigned char> &buffer, size_t &offset);
+
+    ~BulletPool();
+};
+
+class Simulation;
+
+//Receives the player commands given to a simulation, e.g. to record them for a replay.
+class InputListener
+{
+public:
+    enum InputType {Press,Release,Shoot};
+
+    //Called for every command, before it is applied. tick is the tick the command takes effect in.
+    virtual void onInput(int tick, int player, InputType type, Player::WalkDirection dir) = 0;
+
+    //Called at the end of every tick
+    virtual void onTick(Simulation *sim) = 0;
+
+    virtual ~InputListener() {}
+};
+
+//Owns the complete state of a match and advances it one tick at a time. It does not know anything about
+//windows, textures or the keyboard. Player commands are given with setPressed, clearPressed and shoot.
+class Simulation
+{
+    float speed; //Game speed
+    int tickRate; //Number of ticks per second
+    float walkStep; //Distance a soldier walks in one tick
+    float bulletStep; //Distance a bullet flies in one tick
+    int cooldownTicks; //Minimum number of ticks between two shots of a player
+    int numBarrels; //Number of barrel objects
+    int numSandbags; //Number of sandbag objects
+    int numPlayers; //Number of player objects
+    int numTeams; //Number of teams. Player i plays in team i % numTeams.
+    int width; //Battlefield width
+    int height; //Battlefield height
+    World world; //Sandbags and barrels. The sandbags are entities 0 to numSandbags-1, the barrels follow.
+    Player* players; //Pointer to player objects
+
+    BulletPool *bullets; //Bullets in flight
+    CollisionGrid *grid; //Broadphase for the bullet collisions
+    ObstacleMap *obstacles; //Tile map of the obstacles, used for soldier movement
+    std::vector<int> destroyed; //Entities destroyed in the last tick
+    HitboxTable hitboxes; //Hitboxes of the objects
+
+    int tickCount; //Number of ticks simulated so far
+
+    //Cells taken by the obstacles. When a soldier gets hit, it respawns on a random free cell, so
+    //we need to keep track of the obstacle locations to avoid spawning on top of an obstacle.
+    OccupancyGrid *occupancy;
+    std::mt19937 gen; //The only random number generator of the match, used for placement and respawns
+    unsigned int seed; //Seed of gen
+    InputListener *listener; //Gets the player commands, may be null
+    WorkerPool *pool; //Threads the phases of a tick are split across, may be null
+
+    //Takes a random free cell and returns its position. Returns (0,0) if there is no free cell.
+    Coord takeRandomCell();
+public:
+    static const int BASE_TICK_RATE = 10; //The game speed is given in pixels per tick at this tick rate
+    static const int SHOOT_COOLDOWN_MS = 100; //Minimum time between two shots of a player
+    static const int WINNING_SCORE = 10; //The first player to reach this score wins the match
+    static const int PLAYER_CHUNK_SIZE = 64; //Number of players per chunk when a pool splits the work
+
+    /*
+    @brief
+        Non-default constructor
+    @params
+        s: game speed, the distance a soldier walks in 100 ms
+        w: battlefield width
+        h: battlefield height
+        nb: number of barrel objects
+        ns: number of sandbag objects
+        np: number of player objects. If the battlefield has fewer cells than objects, the number of
+            sandbags and barrels is reduced so that every soldier still gets a cell.
+        maxBullets: maximum number of bullets in flight. Shots are ignored while the limit is reached.
+        tickRate: number of ticks per simulated second. Soldiers and bullets move the same distance per
+                  second at any tick rate, but soldiers turn and animate one step per tick.
+    */
+    Simulation(float s, int w, int h, int nb, int ns, int np, int maxBullets = 1024, int tickRate = BASE_TICK_RATE);
+
+    ~Simulation();
+
+    //Replaces the built-in hitboxes, e.g. with hitboxes generated from the loaded images.
+    //Must be called before initWarzone().
+    void setHitboxes(const HitboxTable &table);
+
+    //Enables or disables precise (pixel exact) bullet collisions. Needs bit masks in the hitbox table.
+    void setPreciseCollision(bool precise);
+
+    bool getPreciseCollision();
+
+    //Seeds the random number generator. The same seed and inputs give the same match.
+    //Must be called before initWarzone(); by default the generator is seeded from std::random_device.
+    void setSeed(unsigned int seed);
+
+    //Returns the seed of the random number generator
+    unsigned int getSeed();
+
+    //Sets the object that gets every player command and tick. Pass null to remove it.
+    void setInputListener(InputListener *listener);
+
+    //Splits the soldier movement, the bullet movement and the collision tests of every tick across the
+    //threads of the pool. Pass null to run them on the calling thread. The result is the same either way.
+    //The pool must outlive the simulation, or be removed before it is destroyed.
+    void setWorkerPool(WorkerPool *pool);
+
+    //Initializes war zone by determining locations for objects.
+    void initWarzone();
+
+    //Appends the complete state of the match to the buffer: the objects, the bullets, the free cells, the
+    //random number generator and the tick counter. The settings given to the constructor are not saved.
+    void saveState(std::vector<unsigned char> &buffer);
+
+    //Restores a state saved by saveState. The simulation must have been constructed with the same settings.
+    //Returns false if the buffer does not fit, in which case the simulation is left unchanged.
+    bool loadState(const std::vector<unsigned char> &buffer);
+
+    //Saves the state of the match for a rollback, replacing the contents of the buffer. Unlike saveState it
+    //leaves out what does not change during a match (the entity positions) and copies the players as one
+    //block. The buffer keeps its memory, so saving every tick does not allocate once it has grown.
+    void saveRollbackState(std::vector<unsigned char> &buffer);
+
+    //Restores a state saved by saveRollbackState of this simulation. The buffer is trusted, so nothing is
+    //copied twice, and only the obstacles whose entities were destroyed or came back are updated. The
+    //entity positions are not written, so the render thread may keep reading them.
+    void loadRollbackState(const std::vector<unsigned char> &buffer);
+
+    //Appends a direction to the input buffer of a player. Takes effect on the next tick.
+    void setPressed(int player, Player::WalkDirection dir);
+
+    //Removes a direction from the input buffer of a player.
+    void clearPressed(int player, Player::WalkDirection dir);
+
+    //Fires a bullet if the player can shoot and the cooldown has expired. Returns true if a bullet was fired.
+    bool shoot(int player);
+
+    //Advances the simulation by one tick: moves the soldiers and bullets, resolves collisions and respawns.
+    void tick();
+
+    //Splits the players into the given number of teams; player i plays in team i % teams. By default every
+    //player is a team of its own. Must be called before initWarzone().
+    void setTeams(int teams);
+
+    //Returns the sum of the scores of the players of the team
+    int getTeamScore(int team);
+
+    //Returns the team that won the match, or -1 if the match is still going on. A team wins when the sum
+    //of the scores of its players reaches WINNING_SCORE. Without teams, this is the index of the winning player.
+    int getWinner();
+
+    //Returns the number of simulated ticks
+    int getTick();
+
+    //Returns the number of ticks per simulated second
+    int getTickRate();
+
+    //Returns the distance a bullet flies in one tick
+    float getBulletStep();
+
+    //Returns the entities destroyed in the last tick
+    const std::vector<int>& getDestroyed();
+
+    float getSpeed();
+    int getWidth();
+    int getHeight();
+    int getNumBarrels();
+    int getNumSandbags();
+    int getNumPlayers();
+    int getNumTeams();
+    const World& getWorld();
+    Player* getPlayers();
+    BulletPool* getBullets();
+    const ObstacleMap* getObstacles();
+};
+
+#endif
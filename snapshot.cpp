@@ -0,0 +1,107 @@
+#include <algorithm>
+#include "snapshot.h"
+#include "input.h"
+
+void RenderSnapshot::capture(Simulation *sim, uint32_t inputsApplied)
+{
+    time = InputQueue::now();
+    tick = sim->getTick();
+    numPlayers = sim->getNumPlayers();
+    Player *players = sim->getPlayers();
+    soldiers.resize(numPlayers);
+    for (int i = 0; i < numPlayers; i++)
+        soldiers[i] = {players[i].getPrevPosition(), players[i].getPosition(), players[i].getState()};
+    BulletPool *pool = sim->getBullets();
+    bullets.resize(pool->getCount());
+    for (int i = 0; i < pool->getCount(); i++)
+        bullets[i] = {pool->getPrevPosition(i), pool->getPosition(i), pool->getDirection(i)};
+    const World &world = sim->getWorld();
+    alive.resize(world.getSize());
+    barrels = 0;
+    for (int i = 0; i < world.getSize(); i++)
+    {
+        alive[i] = world.isAlive(i);
+        barrels += alive[i] && world.getType(i) == World::Barrel;
+    }
+    teamScores.resize(sim->getNumTeams());
+    for (int i = 0; i < sim->getNumTeams(); i++)
+        teamScores[i] = sim->getTeamScore(i);
+    winner = sim->getWinner();
+    this->inputsApplied = inputsApplied;
+}
+
+void RenderSnapshot::capture(NetClient *client, Simulation *sim, uint32_t inputsApplied)
+{
+    const NetState &state = client->getState();
+    const NetState *prev = client->getPreviousState();
+    float bulletStep = sim->getBulletStep();
+    time = InputQueue::now();
+    tick = state.tick;
+    numPlayers = sim->getNumPlayers();
+    //Both lists of soldiers are sorted, so the previous positions are found walking along
+    soldiers.resize(state.players.size());
+    size_t k = 0;
+    for (size_t i = 0; i < soldiers.size(); i++)
+    {
+        const NetState::Soldier &s = state.soldiers[i];
+        Coord pos(s.x, s.y), from = pos;
+        while(prev && k < prev->players.size() && prev->players[k] < state.players[i])
+            k++;
+        if(prev && k < prev->players.size() && prev->players[k] == state.players[i])
+            from = Coord(prev->soldiers[k].x, prev->soldiers[k].y);
+        soldiers[i] = {from, pos, std::min<int>(s.state, 13)};
+    }
+    //Bullets fly straight, so they were one step back along their direction a tick ago
+    static const float STEP_X[4] = {-1, 0, 1, 0};
+    static const float STEP_Y[4] = {0, -1, 0, 1};
+    bullets.resize(state.bullets.size());
+    for (size_t i = 0; i < bullets.size(); i++)
+    {
+        const NetState::Bullet &b = state.bullets[i];
+        int dir = std::min<int>(b.dir, BulletPool::Down);
+        Coord pos(b.x, b.y);
+        bullets[i] = {Coord(pos.x - STEP_X[dir]*bulletStep, pos.y - STEP_Y[dir]*bulletStep), pos, dir};
+    }
+    alive = client->getAlive();
+    const World &world = sim->getWorld();
+    barrels = 0;
+    for (size_t i = 0; i < alive.size() && i < (size_t)world.getSize(); i++)
+        barrels += alive[i] && world.getType(i) == World::Barrel;
+    const std::vector<int> &scores = client->getTeamScores();
+    teamScores.assign(sim->getNumTeams(), 0);
+    std::copy(scores.begin(), scores.begin() + std::min(scores.size(), teamScores.size()), teamScores.begin());
+    winner = client->getWinner();
+    this->inputsApplied = inputsApplied;
+}
+
+SnapshotBuffer::SnapshotBuffer()
+{
+    back = 0;
+    middle = 1;
+    front = 2;
+}
+
+RenderSnapshot& SnapshotBuffer::getBack()
+{
+    return slots[back];
+}
+
+void SnapshotBuffer::publish()
+{
+    //The release makes the snapshot visible to the renderer; the acquire makes sure the renderer is done
+    //with the slot we get back
+    back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & ~FRESH;
+}
+
+bool SnapshotBuffer::update()
+{
+    if(!(middle.load(std::memory_order_relaxed) & FRESH))
+        return false;
+    front = middle.exchange(front, std::memory_order_acq_rel) & ~FRESH;
+    return true;
+}
+
+const RenderSnapshot& SnapshotBuffer::getFront()
+{
+    return slots[front];
+}
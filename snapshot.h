@@ -0,0 +1,77 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "simulation.h"
+#include "netclient.h"
+
+//Everything the window needs to draw one tick of a match, copied out of the simulation so the window can
+//draw it while the simulation already works on the next tick.
+struct RenderSnapshot
+{
+    //A soldier or a bullet, with its positions at the previous and at this tick for interpolation
+    struct Sprite
+    {
+        Coord prev;
+        Coord pos;
+        int state; //Player::getState() of a soldier, BulletPool::TravelDirection of a bullet
+    };
+
+    int64_t time; //InputQueue::now() when the snapshot was taken
+    int tick; //Simulation::getTick()
+    std::vector<Sprite> soldiers; //On a client, only the soldiers in its area of interest
+    std::vector<Sprite> bullets;
+    std::vector<unsigned char> alive; //World::isAlive() of every entity
+    int barrels; //Number of barrels still standing
+    int numPlayers;
+    std::vector<int> teamScores; //Simulation::getTeamScore() of every team
+    int winner; //Simulation::getWinner()
+    uint32_t inputsApplied; //Number of keyboard commands applied up to this tick, see Game::applyInputs()
+
+    //Copies the state of the simulation. Reuses the memory of the last capture.
+    void capture(Simulation *sim, uint32_t inputsApplied);
+
+    /*
+    @brief
+        Copies the newest state a client received from a game server. The soldiers move between the previous
+        and the newest state; those that were not in the previous one stand.
+    @params
+        client: the client
+        sim: simulation with the settings and the entities of the match, which is not ticked
+        inputsApplied: see the member
+    */
+    void capture(NetClient *client, Simulation *sim, uint32_t inputsApplied);
+};
+
+//Three snapshots that pass the newest tick from the simulation thread to the render thread without locks.
+//The simulation fills the back snapshot and publishes it; the renderer takes the newest published one
+//whenever it starts a frame. Neither side ever waits: snapshots that the renderer was too slow to pick up
+//are overwritten, and the renderer draws the same snapshot again if no new one arrived.
+class SnapshotBuffer
+{
+    static const int FRESH = 4; //Set in middle while the snapshot there has not been taken
+
+    RenderSnapshot slots[3];
+    int back; //Slot the simulation writes, owned by the simulation thread
+    int front; //Slot the renderer reads, owned by the render thread
+    std::atomic<int> middle; //Slot last published
+public:
+    SnapshotBuffer();
+
+    //Returns the snapshot to fill. Simulation thread only.
+    RenderSnapshot& getBack();
+
+    //Hands the back snapshot over to the renderer. Simulation thread only.
+    void publish();
+
+    //Takes the newest published snapshot. Returns false if none was published since the last call, in which
+    //case the front snapshot stays. Render thread only.
+    bool update();
+
+    //Returns the snapshot taken by the last update() call. Render thread only.
+    const RenderSnapshot& getFront();
+};
+
+#endif
@@ -0,0 +1,137 @@
+#include <algorithm>
+#include "workers.h"
+#include "profiler.h"
+
+WorkerPool::WorkerPool(int numThreads)
+{
+    if(numThreads <= 0)
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    body = nullptr;
+    size = 0;
+    grain = 1;
+    busy = 0;
+    generation = 0;
+    stop = false;
+    ranges = new ChunkRange[numThreads];
+    for (int i = 0; i < numThreads; i++)
+        ranges[i].begin = ranges[i].end = 0;
+    for (int i = 1; i < numThreads; i++) //The calling thread is the first one
+        threads.push_back(std::thread(&WorkerPool::work, this, i));
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    wake.notify_all();
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+    delete[] ranges;
+}
+
+int WorkerPool::getNumThreads()
+{
+    return threads.size() + 1;
+}
+
+int WorkerPool::takeChunk(int thread)
+{
+    ChunkRange &own = ranges[thread];
+    {
+        std::lock_guard<std::mutex> lock(own.lock);
+        if(own.begin < own.end)
+            return own.begin++;
+    }
+    //Steal the upper half of the chunks of the first thread that has some left. Only one range is locked
+    //at a time, so two thieves can not deadlock.
+    int numThreads = threads.size() + 1;
+    for (int k = 1; k < numThreads; k++)
+    {
+        ChunkRange &victim = ranges[(thread + k) % numThreads];
+        int begin, end;
+        {
+            std::lock_guard<std::mutex> lock(victim.lock);
+            if(victim.begin >= victim.end)
+                continue;
+            begin = victim.begin + (victim.end - victim.begin) / 2;
+            end = victim.end;
+            victim.end = begin;
+        }
+        //Run the first stolen chunk right away and keep the rest, others may steal them in turn
+        std::lock_guard<std::mutex> lock(own.lock);
+        own.begin = begin + 1;
+        own.end = end;
+        return begin;
+    }
+    return -1;
+}
+
+void WorkerPool::runChunks(int thread)
+{
+    while(1)
+    {
+        int chunk = takeChunk(thread);
+        if(chunk == -1)
+            break;
+        PROFILE_SCOPE("chunk");
+        (*body)(chunk * grain, std::min(size, (chunk + 1) * grain));
+    }
+}
+
+void WorkerPool::work(int thread)
+{
+    unsigned int seen = 0;
+    while(1)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stop || generation != seen; });
+            if(stop)
+                return;
+            seen = generation;
+        }
+        runChunks(thread);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy--;
+        }
+        done.notify_one();
+    }
+}
+
+void WorkerPool::parallelFor(int n, int grain, const std::function<void(int,int)> &body)
+{
+    if(n <= 0)
+        return;
+    grain = std::max(1, grain);
+    //Not worth waking anybody up for a single chunk
+    if(threads.empty() || n <= grain)
+    {
+        body(0, n);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->body = &body;
+        size = n;
+        this->grain = grain;
+        //Deal the chunks out evenly, in order
+        int numChunks = (n + grain - 1) / grain;
+        int numThreads = threads.size() + 1;
+        for (int i = 0; i < numThreads; i++)
+        {
+            std::lock_guard<std::mutex> rangeLock(ranges[i].lock);
+            ranges[i].begin = (long long)numChunks * i / numThreads;
+            ranges[i].end = (long long)numChunks * (i + 1) / numThreads;
+        }
+        busy = threads.size();
+        generation++;
+    }
+    wake.notify_all();
+    runChunks(0);
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return busy == 0; });
+    this->body = nullptr;
+}
@@ -0,0 +1,62 @@
+#ifndef WORKERS_H
+#define WORKERS_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+//Fixed set of worker threads for splitting a loop across cores. The threads sleep between two loops,
+//so an idle pool costs nothing.
+//The chunks of a loop are dealt out evenly to the threads up front. A thread works through its own chunks
+//in order, and when it runs out it steals the upper half of the chunks another thread has left, so a thread
+//that got the expensive chunks does not hold everybody up.
+class WorkerPool
+{
+    //Chunks [begin,end) a thread still has to run
+    struct ChunkRange
+    {
+        std::mutex lock;
+        int begin;
+        int end;
+    };
+
+    std::vector<std::thread> threads;
+    ChunkRange *ranges; //One per thread, the calling thread is 0
+    std::mutex mutex;
+    std::condition_variable wake; //Signals a new loop, or the end of the pool
+    std::condition_variable done; //Signals that every worker left the current loop
+    const std::function<void(int,int)> *body; //Body of the current loop
+    int size; //Number of iterations of the current loop
+    int grain; //Number of iterations per chunk
+    int busy; //Number of workers still in the current loop
+    unsigned int generation; //Incremented for every loop, so the workers can tell a new loop from the last one
+    bool stop; //Set when the pool is destroyed
+
+    //Takes the next chunk of the thread, or steals chunks from another thread if it has none left.
+    //Returns -1 if no thread has any chunks left.
+    int takeChunk(int thread);
+
+    //Runs chunks of the current loop until there are none left
+    void runChunks(int thread);
+
+    //Main function of the worker threads
+    void work(int thread);
+public:
+    //Creates a pool that runs loops on numThreads threads, the calling thread included.
+    //0 means one thread per core.
+    WorkerPool(int numThreads = 0);
+
+    ~WorkerPool();
+
+    //Returns the number of threads that run a loop, the calling thread included
+    int getNumThreads();
+
+    //Calls body(begin,end) for consecutive ranges of at most grain iterations that together cover [0,n).
+    //The ranges run in parallel, in no particular order. Returns when all of them are done.
+    //A body that only writes to the elements of its own range gives the same result on any number of threads.
+    void parallelFor(int n, int grain, const std::function<void(int,int)> &body);
+};
+
+#endif